@@ -7,6 +7,8 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -71,6 +73,7 @@ struct channel
     uint8_t irq;                /* Interrupt in use. */
 
     struct lock lock;           /* Must acquire to access the controller. */
+    struct lock_profile lock_profile; /* Contention statistics for LOCK. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
@@ -86,6 +89,7 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
+static void trace_command (struct disk *, disk_sector_t, uint8_t command);
 static void select_sector (struct disk *, disk_sector_t);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
@@ -125,6 +129,7 @@ disk_init (void)
           NOT_REACHED ();
         }
       lock_init (&c->lock);
+      lock_profile (&c->lock, &c->lock_profile, c->name);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
  
@@ -226,6 +231,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer)
 
   c = d->channel;
   lock_acquire (&c->lock);
+  trace_command (d, sec_no, CMD_READ_SECTOR_RETRY);
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_READ_SECTOR_RETRY);
   sema_down (&c->completion_wait);
@@ -233,6 +239,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer)
     PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
   input_sector (c, buffer);
   d->read_cnt++;
+  thread_current ()->usage.sectors_read++;
   lock_release (&c->lock);
 }
 
@@ -251,6 +258,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer)
 
   c = d->channel;
   lock_acquire (&c->lock);
+  trace_command (d, sec_no, CMD_WRITE_SECTOR_RETRY);
   select_sector (d, sec_no);
   issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy (d))
@@ -258,6 +266,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer)
   output_sector (c, buffer);
   sema_down (&c->completion_wait);
   d->write_cnt++;
+  thread_current ()->usage.sectors_written++;
   lock_release (&c->lock);
 }
 
@@ -425,6 +434,17 @@ print_ata_string (char *string, size_t size)
     printf ("%c", string[i ^ 1]);
 }
 
+/* Records COMMAND on sector SEC_NO of disk D in the event trace.
+   The device is numbered 2 * channel + device, so that hd1:0 is
+   device 2. */
+static void
+trace_command (struct disk *d, disk_sector_t sec_no, uint8_t command)
+{
+  int dev = (d->channel - channels) * 2 + d->dev_no;
+
+  trace_event (TRACE_DISK, sec_no, (dev << 8) | command);
+}
+
 /* Selects device D, waiting for it to become ready, and then
    writes SEC_NO to the disk's sector selection registers.  (We
    use LBA mode.) */
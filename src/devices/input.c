@@ -3,14 +3,18 @@
 #include "devices/intq.h"
 #include "devices/serial.h"
 
-/* Stores keys from the keyboard and serial port. */
+/* Stores keys from the keyboard and serial port.  The keyboard
+   and serial interrupt handlers are its producers; readers are
+   serialized by READERS. */
 static struct intq buffer;
+static struct lock readers;
 
 /* Initializes the input buffer. */
 void
 input_init (void) 
 {
   intq_init (&buffer);
+  lock_init (&readers);
 }
 
 /* Adds a key to the input buffer.
@@ -30,17 +34,41 @@ input_putc (uint8_t key)
 uint8_t
 input_getc (void) 
 {
-  enum intr_level old_level;
   uint8_t key;
 
-  old_level = intr_disable ();
-  key = intq_getc (&buffer);
-  serial_notify ();
-  intr_set_level (old_level);
-  
+  input_read (&key, 1);
   return key;
 }
 
+/* Reads SIZE keys into DST, taking as many as are buffered at a
+   time and waiting for more as needed. */
+void
+input_read (void *dst_, size_t size) 
+{
+  uint8_t *dst = dst_;
+  enum intr_level old_level;
+
+  lock_acquire (&readers);
+  while (size > 0)
+    {
+      size_t cnt = intq_get (&buffer, dst, size);
+      if (cnt == 0)
+        {
+          /* Sleep until a key arrives. */
+          intq_read (&buffer, dst, 1);
+          cnt = 1;
+        }
+      dst += cnt;
+      size -= cnt;
+
+      /* Room was made; let the serial port receive again. */
+      old_level = intr_disable ();
+      serial_notify ();
+      intr_set_level (old_level);
+    }
+  lock_release (&readers);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -2,11 +2,13 @@
 #define DEVICES_INPUT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+void input_read (void *, size_t);
 bool input_full (void);
 
 #endif /* devices/input.h */
@@ -1,8 +1,8 @@
 #include "devices/intq.h"
 #include <debug.h>
+#include <string.h>
 #include "threads/thread.h"
 
-static int next (int pos);
 static void wait (struct intq *q, struct thread **waiter);
 static void signal (struct intq *q, struct thread **waiter);
 
@@ -19,7 +19,6 @@ intq_init (struct intq *q)
 bool
 intq_empty (const struct intq *q) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
   return q->head == q->tail;
 }
 
@@ -27,8 +26,105 @@ intq_empty (const struct intq *q)
 bool
 intq_full (const struct intq *q) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  return next (q->head) == q->tail;
+  return q->head - q->tail == INTQ_BUFSIZE;
+}
+
+/* Removes up to SIZE bytes from Q into BUFFER, without waiting.
+   Returns the number of bytes removed.  Must be called by Q's
+   consumer. */
+size_t
+intq_get (struct intq *q, void *buffer_, size_t size) 
+{
+  uint8_t *buffer = buffer_;
+  unsigned tail = q->tail;
+  size_t cnt = q->head - tail;
+  size_t ofs = tail % INTQ_BUFSIZE;
+  size_t first;
+
+  if (cnt > size)
+    cnt = size;
+  if (cnt == 0)
+    return 0;
+
+  /* Read the bytes only after reading HEAD, and release their
+     slots only after reading the bytes. */
+  barrier ();
+  first = cnt < INTQ_BUFSIZE - ofs ? cnt : INTQ_BUFSIZE - ofs;
+  memcpy (buffer, q->buf + ofs, first);
+  memcpy (buffer + first, q->buf, cnt - first);
+  barrier ();
+  q->tail = tail + cnt;
+
+  signal (q, &q->not_full);
+  return cnt;
+}
+
+/* Adds up to SIZE bytes from BUFFER to the end of Q, without
+   waiting.  Returns the number of bytes added.  Must be called by
+   Q's producer. */
+size_t
+intq_put (struct intq *q, const void *buffer_, size_t size) 
+{
+  const uint8_t *buffer = buffer_;
+  unsigned head = q->head;
+  size_t cnt = INTQ_BUFSIZE - (head - q->tail);
+  size_t ofs = head % INTQ_BUFSIZE;
+  size_t first;
+
+  if (cnt > size)
+    cnt = size;
+  if (cnt == 0)
+    return 0;
+
+  /* Fill the slots only after reading TAIL, and publish them
+     only after filling them. */
+  barrier ();
+  first = cnt < INTQ_BUFSIZE - ofs ? cnt : INTQ_BUFSIZE - ofs;
+  memcpy (q->buf + ofs, buffer, first);
+  memcpy (q->buf, buffer + first, cnt - first);
+  barrier ();
+  q->head = head + cnt;
+
+  signal (q, &q->not_empty);
+  return cnt;
+}
+
+/* Removes SIZE bytes from Q into BUFFER, sleeping whenever Q is
+   empty.  Must be called by Q's consumer, and from an interrupt
+   handler only if Q holds at least SIZE bytes. */
+void
+intq_read (struct intq *q, void *buffer_, size_t size) 
+{
+  uint8_t *buffer = buffer_;
+
+  for (;;)
+    {
+      size_t cnt = intq_get (q, buffer, size);
+      buffer += cnt;
+      size -= cnt;
+      if (size == 0)
+        break;
+      wait (q, &q->not_empty);
+    }
+}
+
+/* Adds the SIZE bytes in BUFFER to the end of Q, sleeping
+   whenever Q is full.  Must be called by Q's producer, and from
+   an interrupt handler only if Q has room for SIZE bytes. */
+void
+intq_write (struct intq *q, const void *buffer_, size_t size) 
+{
+  const uint8_t *buffer = buffer_;
+
+  for (;;)
+    {
+      size_t cnt = intq_put (q, buffer, size);
+      buffer += cnt;
+      size -= cnt;
+      if (size == 0)
+        break;
+      wait (q, &q->not_full);
+    }
 }
 
 /* Removes a byte from Q and returns it.
@@ -39,19 +135,8 @@ uint8_t
 intq_getc (struct intq *q) 
 {
   uint8_t byte;
-  
-  ASSERT (intr_get_level () == INTR_OFF);
-  while (intq_empty (q)) 
-    {
-      ASSERT (!intr_context ());
-      lock_acquire (&q->lock);
-      wait (q, &q->not_empty);
-      lock_release (&q->lock);
-    }
-  
-  byte = q->buf[q->tail];
-  q->tail = next (q->tail);
-  signal (q, &q->not_full);
+
+  intq_read (q, &byte, 1);
   return byte;
 }
 
@@ -62,55 +147,51 @@ intq_getc (struct intq *q)
 void
 intq_putc (struct intq *q, uint8_t byte) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  while (intq_full (q))
-    {
-      ASSERT (!intr_context ());
-      lock_acquire (&q->lock);
-      wait (q, &q->not_full);
-      lock_release (&q->lock);
-    }
-
-  q->buf[q->head] = byte;
-  q->head = next (q->head);
-  signal (q, &q->not_empty);
-}
-
-/* Returns the position after POS within an intq. */
-static int
-next (int pos) 
-{
-  return (pos + 1) % INTQ_BUFSIZE;
+  intq_write (q, &byte, 1);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
    member.  Waits until the given condition is true. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) 
+wait (struct intq *q, struct thread **waiter) 
 {
+  enum intr_level old_level;
+
   ASSERT (!intr_context ());
-  ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT ((waiter == &q->not_empty && intq_empty (q))
-          || (waiter == &q->not_full && intq_full (q)));
+  ASSERT (waiter == &q->not_empty || waiter == &q->not_full);
 
-  *waiter = thread_current ();
-  thread_block ();
+  lock_acquire (&q->lock);
+  old_level = intr_disable ();
+  while (waiter == &q->not_empty ? intq_empty (q) : intq_full (q))
+    {
+      *waiter = thread_current ();
+      thread_block ();
+    }
+  intr_set_level (old_level);
+  lock_release (&q->lock);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
    member, and the associated condition must be true.  If a
    thread is waiting for the condition, wakes it up and resets
-   the waiting thread. */
+   the waiting thread.
+
+   A waiter sets *WAITER with interrupts off, after finding the
+   condition false, so if *WAITER is still null here, the waiter
+   will see the condition true and not sleep. */
 static void
 signal (struct intq *q UNUSED, struct thread **waiter) 
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT ((waiter == &q->not_empty && !intq_empty (q))
-          || (waiter == &q->not_full && !intq_full (q)));
+  enum intr_level old_level;
+
+  if (*waiter == NULL)
+    return;
 
+  old_level = intr_disable ();
   if (*waiter != NULL) 
     {
       thread_unblock (*waiter);
       *waiter = NULL;
     }
+  intr_set_level (old_level);
 }
@@ -1,23 +1,29 @@
 #ifndef DEVICES_INTQ_H
 #define DEVICES_INTQ_H
 
+#include <stddef.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 
 /* An "interrupt queue", a circular buffer shared between
    kernel threads and external interrupt handlers.
 
-   Interrupt queue functions can be called from kernel threads or
-   from external interrupt handlers.  Except for intq_init(),
-   interrupts must be off in either case.
-
-   The interrupt queue has the structure of a "monitor".  Locks
-   and condition variables from threads/synch.h cannot be used in
-   this case, as they normally would, because they can only
-   protect kernel threads from one another, not from interrupt
-   handlers. */
-
-/* Queue buffer size, in bytes. */
+   The queue is a single-producer, single-consumer ring: only
+   the producer advances HEAD and only the consumer advances
+   TAIL, so moving bytes in or out needs no lock and does not
+   disable interrupts.  There may be one producer and one
+   consumer at a time.  A side with more than one potential
+   caller must serialize them itself, for example by disabling
+   interrupts around the call or by holding a lock.  An
+   interrupt handler may be either side but must not wait.
+
+   Interrupts are disabled only briefly, to put a thread to sleep
+   on an empty or full queue and to wake it up again.  Locks and
+   condition variables from threads/synch.h cannot be used for
+   that, because they can only protect kernel threads from one
+   another, not from interrupt handlers. */
+
+/* Queue buffer size, in bytes.  Must be a power of 2. */
 #define INTQ_BUFSIZE 64
 
 /* A circular queue of bytes. */
@@ -30,13 +36,17 @@ struct intq
 
     /* Queue. */
     uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
-    int head;                   /* New data is written here. */
-    int tail;                   /* Old data is read here. */
+    volatile unsigned head;     /* Bytes ever added; written by producer. */
+    volatile unsigned tail;     /* Bytes ever removed; written by consumer. */
   };
 
 void intq_init (struct intq *);
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
+size_t intq_get (struct intq *, void *, size_t);
+size_t intq_put (struct intq *, const void *, size_t);
+void intq_read (struct intq *, void *, size_t);
+void intq_write (struct intq *, const void *, size_t);
 uint8_t intq_getc (struct intq *);
 void intq_putc (struct intq *, uint8_t);
 
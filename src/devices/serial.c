@@ -37,6 +37,14 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable receive and transmit FIFOs. */
+#define FCR_CLEAR_RX 0x02       /* Empty the receive FIFO. */
+#define FCR_CLEAR_TX 0x04       /* Empty the transmit FIFO. */
+
+/* Bytes held by the 16550A's transmit FIFO. */
+#define FIFO_SIZE 16
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -51,11 +59,15 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
+/* Data to be transmitted.  In queued mode the UART's transmit
+   FIFO is enabled and refilled from here FIFO_SIZE bytes at a
+   time, once per transmit interrupt.  Both ends of the queue are
+   only touched with interrupts off. */
 static struct intq txq;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void xmit_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -88,6 +100,7 @@ serial_init_queue (void)
   ASSERT (mode == POLL);
 
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX);
   mode = QUEUE;
   old_level = intr_disable ();
   write_ier ();
@@ -98,32 +111,54 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_write (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port. */
+void
+serial_write (const void *buffer_, size_t size) 
+{
+  const uint8_t *buffer = buffer_;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit each byte. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (size-- > 0)
+        putc_poll (*buffer++); 
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue as many bytes as fit at once and update
+         the interrupt enable register. */
+      while (size > 0) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          size_t cnt = intq_put (&txq, buffer, size);
+          buffer += cnt;
+          size -= cnt;
+          write_ier ();
+          if (size == 0)
+            break;
+
+          if (old_level == INTR_OFF) 
+            {
+              /* Interrupts are off and the transmit queue is full.
+                 If we wanted to wait for the queue to empty,
+                 we'd have to reenable interrupts.
+                 That's impolite, so we'll send a FIFO's worth
+                 via polling instead. */
+              xmit_fifo ();
+            }
+          else 
+            {
+              /* Sleep until the transmit interrupt makes room. */
+              intq_putc (&txq, *buffer++);
+              size--;
+            }
         }
-
-      intq_putc (&txq, byte); 
-      write_ier ();
     }
   
   intr_set_level (old_level);
@@ -136,7 +171,7 @@ serial_flush (void)
 {
   enum intr_level old_level = intr_disable ();
   while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+    xmit_fifo ();
   intr_set_level (old_level);
 }
 
@@ -205,6 +240,22 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Polls the serial port until its transmit FIFO is empty, then
+   refills it from the transmit queue. */
+static void
+xmit_fifo (void) 
+{
+  uint8_t burst[FIFO_SIZE];
+  size_t cnt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while ((inb (LSR_REG) & LSR_THRE) == 0)
+    continue;
+  cnt = intq_get (&txq, burst, sizeof burst);
+  outsb (THR_REG, burst, cnt);
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +269,10 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmit FIFO has drained, refill it with up to a
+     FIFO's worth of bytes in one burst. */
+  if (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
+    xmit_fifo ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
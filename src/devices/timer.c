@@ -5,8 +5,10 @@
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/profiler.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "userprog/gdt.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -23,6 +25,12 @@
 static int64_t ticks;
 static struct list sleep_list;
 
+/* Timer interrupts per tick, more than 1 only when the profiler
+   samples faster than TIMER_FREQ, and interrupts since the last
+   tick. */
+static unsigned interrupts_per_tick = 1;
+static unsigned interrupts;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -36,14 +44,16 @@ static void real_time_sleep (int64_t num, int32_t denom);
 
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
-   interrupt PIT_FREQ times per second, and registers the
-   corresponding interrupt. */
+   interrupt TIMER_FREQ times per second, or profiler_hz times if
+   that is faster, and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
-  /* 8254 input frequency divided by TIMER_FREQ, rounded to
-     nearest. */
-  uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+  int hz = profiler_hz > TIMER_FREQ ? profiler_hz : TIMER_FREQ;
+
+  /* 8254 input frequency divided by HZ, rounded to nearest. */
+  uint16_t count = (1193180 + hz / 2) / hz;
+  interrupts_per_tick = hz / TIMER_FREQ;
   list_init(&sleep_list);
   outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
   outb (0x40, count & 0xff);
@@ -161,11 +171,16 @@ wakeup_sleep_thread(void){
 }
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
   //printf("timer: %d\n",ticks);
+  if (profiler_hz != 0)
+    profiler_sample (args);
+  if (++interrupts < interrupts_per_tick)
+    return;
+  interrupts = 0;
   ticks++;
-  thread_tick ();
+  thread_tick (args->cs == SEL_UCSEG);
   wakeup_sleep_thread();
   
 }
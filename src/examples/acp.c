@@ -0,0 +1,123 @@
+/* acp.c
+
+   Copies one file to another, using the asynchronous I/O ring.
+   Writes of one batch of blocks are queued together with reads
+   of the next batch, so each batch costs a single system call. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+#define BLOCK_SIZE 4096
+#define BATCH 16
+
+static char buffers[2][BATCH][BLOCK_SIZE];
+static struct ioring *ring;
+
+/* Queues a read or write of block BLOCK, of SIZE bytes total,
+   between the file FD and BUFFER.  Returns the number of bytes
+   queued. */
+static int
+queue (enum ioring_op op, int fd, char *buffer, int block, int size)
+{
+  struct ioring_sqe *sqe = &ring->sq[ring->sq_tail % IORING_ENTRIES];
+  int ofs = block * BLOCK_SIZE;
+  int len = size - ofs < BLOCK_SIZE ? size - ofs : BLOCK_SIZE;
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buffer;
+  sqe->len = len;
+  sqe->offset = ofs;
+  sqe->user_data = len;
+  ring->sq_tail++;
+  return len;
+}
+
+/* Consumes CNT completions.  Returns false if any transferred
+   fewer bytes than requested. */
+static bool
+reap (int cnt)
+{
+  bool ok = true;
+
+  for (; cnt > 0; cnt--, ring->cq_head++)
+    {
+      struct ioring_cqe *cqe = &ring->cq[ring->cq_head % IORING_ENTRIES];
+      if (cqe->res != (int) cqe->user_data)
+        ok = false;
+    }
+  return ok;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int in_fd, out_fd;
+  int size, block_cnt, block, i;
+  int cur = 0;
+
+  if (argc != 3) 
+    {
+      printf ("usage: acp OLD NEW\n");
+      return EXIT_FAILURE;
+    }
+
+  ring = ioring_setup ();
+  if (ring == NULL)
+    {
+      printf ("acp: ioring_setup failed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Open input file. */
+  in_fd = open (argv[1]);
+  if (in_fd < 0) 
+    {
+      printf ("%s: open failed\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  size = filesize (in_fd);
+  block_cnt = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  /* Create and open output file. */
+  if (!create (argv[2], size)) 
+    {
+      printf ("%s: create failed\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+  out_fd = open (argv[2]);
+  if (out_fd < 0) 
+    {
+      printf ("%s: open failed\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+
+  /* Read the first batch, then write each batch while reading
+     the next. */
+  for (block = 0; block < BATCH && block < block_cnt; block++)
+    queue (IORING_OP_READ, in_fd, buffers[cur][block], block, size);
+  ioring_enter (block, block);
+  if (!reap (block))
+    {
+      printf ("%s: read failed\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+
+  for (block = 0; block < block_cnt; block += BATCH, cur = !cur)
+    {
+      int cnt = 0;
+
+      for (i = 0; i < BATCH && block + i < block_cnt; i++, cnt++)
+        queue (IORING_OP_WRITE, out_fd, buffers[cur][i], block + i, size);
+      for (i = 0; i < BATCH && block + BATCH + i < block_cnt; i++, cnt++)
+        queue (IORING_OP_READ, in_fd, buffers[!cur][i], block + BATCH + i,
+               size);
+      if (ioring_enter (cnt, cnt) != cnt || !reap (cnt))
+        {
+          printf ("%s: copy failed\n", argv[2]);
+          return EXIT_FAILURE;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
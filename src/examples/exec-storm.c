@@ -0,0 +1,60 @@
+/* exec-storm.c
+
+   Measures process startup by exec()ing a trivial child over and
+   over, first one at a time and then in waves of several children
+   running at once.  Run it as the only action, e.g.
+   "pintos -- run 'exec-storm 200'", and compare the timer tick
+   count the kernel prints at power off. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Children started at once in each wave. */
+#define WAVE 8
+
+int
+main (int argc, char *argv[]) 
+{
+  pid_t children[WAVE];
+  int cnt = 100;
+  int i, j;
+
+  if (argc == 2 && !strcmp (argv[1], "child"))
+    return 0;
+  if (argc == 2)
+    cnt = atoi (argv[1]);
+  if (argc > 2 || cnt <= 0)
+    {
+      printf ("usage: exec-storm [COUNT]\n");
+      return EXIT_FAILURE;
+    }
+
+  /* One child at a time. */
+  for (i = 0; i < cnt; i++)
+    {
+      pid_t pid = exec ("exec-storm child");
+      if (pid == PID_ERROR || wait (pid) != 0)
+        {
+          printf ("exec-storm: serial exec %d failed\n", i);
+          return EXIT_FAILURE;
+        }
+    }
+  printf ("exec-storm: %d serial execs done\n", cnt);
+
+  /* Waves of WAVE children. */
+  for (i = 0; i < cnt; i += WAVE)
+    {
+      for (j = 0; j < WAVE; j++)
+        children[j] = exec ("exec-storm child");
+      for (j = 0; j < WAVE; j++)
+        if (children[j] == PID_ERROR || wait (children[j]) != 0)
+          {
+            printf ("exec-storm: parallel exec %d failed\n", i + j);
+            return EXIT_FAILURE;
+          }
+    }
+  printf ("exec-storm: %d parallel execs done\n", (cnt + WAVE - 1) / WAVE * WAVE);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+/* latency.c
+
+   Prints the kernel's system call and page fault latency
+   histograms as operation counts and approximate median and 99th
+   percentile latencies.  The kernel only gathers them when booted
+   with the "-latency" option. */
+
+#include <latency.h>
+#include <stdio.h>
+#include <syscall.h>
+
+#define MAX_HISTS 64
+
+int
+main (void)
+{
+  static struct latency_hist hists[MAX_HISTS];
+  int cnt = latency (hists, MAX_HISTS);
+  int i;
+
+  if (cnt < 0)
+    {
+      printf ("latency: failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%-16s %10s %12s %12s %12s %12s\n",
+          "operation", "ops", "mean", "p50 <", "p99 <", "max");
+  for (i = 0; i < cnt; i++)
+    {
+      struct latency_hist *h = &hists[i];
+      if (h->cnt == 0)
+        continue;
+      printf ("%-16s %10u %12llu %12llu %12llu %12llu\n",
+              h->name, h->cnt, h->total_cycles / h->cnt,
+              latency_percentile (h, 50), latency_percentile (h, 99),
+              h->max_cycles);
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,32 @@
+/* lockstat.c
+
+   Prints the contention statistics of the kernel's profiled
+   locks.  The kernel only gathers them when booted with the
+   "-lockprof" option. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+#define MAX_LOCKS 32
+
+int
+main (void) 
+{
+  static struct lockstat stats[MAX_LOCKS];
+  int cnt = lockstat (stats, MAX_LOCKS);
+  int i;
+
+  if (cnt < 0)
+    {
+      printf ("lockstat: failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%-16s %10s %10s %10s %10s\n",
+          "lock", "acquires", "contended", "wait", "max hold");
+  for (i = 0; i < cnt; i++)
+    printf ("%-16s %10u %10u %10lld %10lld\n",
+            stats[i].name, stats[i].acquire_cnt, stats[i].contended_cnt,
+            stats[i].wait_ticks, stats[i].max_hold_ticks);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/* rusage.c
+
+   Runs a command, waits for it, and prints the resources it and
+   its waited-for descendants used, e.g. "rusage matmult". */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+int
+main (int argc, char *argv[])
+{
+  char cmd[128];
+  struct rusage ru;
+  pid_t pid;
+  int i, status;
+
+  if (argc < 2)
+    {
+      printf ("usage: rusage COMMAND [ARG...]\n");
+      return EXIT_FAILURE;
+    }
+
+  cmd[0] = '\0';
+  for (i = 1; i < argc; i++)
+    {
+      if (i > 1)
+        strlcat (cmd, " ", sizeof cmd);
+      strlcat (cmd, argv[i], sizeof cmd);
+    }
+
+  pid = exec (cmd);
+  if (pid == PID_ERROR)
+    {
+      printf ("rusage: %s: exec failed\n", cmd);
+      return EXIT_FAILURE;
+    }
+  status = wait (pid);
+
+  if (getrusage (RUSAGE_CHILDREN, &ru) < 0)
+    {
+      printf ("rusage: getrusage failed\n");
+      return EXIT_FAILURE;
+    }
+  printf ("%s: exit status %d\n", cmd, status);
+  printf ("  %lld user ticks, %lld kernel ticks\n",
+          ru.user_ticks, ru.kernel_ticks);
+  printf ("  %u major faults, %u minor faults\n",
+          ru.major_faults, ru.minor_faults);
+  printf ("  %u swap-ins, %u swap-outs\n", ru.swap_ins, ru.swap_outs);
+  printf ("  %u sectors read, %u sectors written\n",
+          ru.sectors_read, ru.sectors_written);
+  printf ("  %u voluntary switches, %u involuntary switches\n",
+          ru.voluntary_switches, ru.involuntary_switches);
+  return EXIT_SUCCESS;
+}
@@ -2,8 +2,19 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
+/* Object cache for `struct file'. */
+static struct slab_cache *file_cache;
 
+/* Initializes the open file module. */
+void
+file_init (void) 
+{
+  file_cache = slab_cache_create ("file", sizeof (struct file), NULL);
+  if (file_cache == NULL)
+    PANIC ("file_init: can't create file cache");
+}
 
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
@@ -11,18 +22,19 @@
 struct file *
 file_open (struct inode *inode) 
 {
-  struct file *file = calloc (1, sizeof *file);
+  struct file *file = slab_alloc (file_cache);
   if (inode != NULL && file != NULL)
     {
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->dir = NULL;
       return file;
     }
   else
     {
       inode_close (inode);
-      free (file);
+      slab_free (file_cache, file);
       return NULL; 
     }
 }
@@ -43,7 +55,7 @@ file_close (struct file *file)
     {
       file_allow_write (file);
       inode_close (file->inode);
-      free (file); 
+      slab_free (file_cache, file); 
     }
 }
 
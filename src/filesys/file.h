@@ -14,6 +14,8 @@ struct file
     struct dir *dir;			/* if file is not directory, NULL */
   };
 
+void file_init (void);
+
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
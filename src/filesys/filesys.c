@@ -8,6 +8,9 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
@@ -24,6 +27,7 @@ filesys_init (bool format)
     PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
   inode_init ();
+  file_init ();
   free_map_init ();
 
   if (format) 
@@ -116,7 +120,19 @@ filesys_remove (const char *name)
   char filename[NAME_MAX + 1];
 
   struct dir *dir = get_path_and_name(name, filename);
-  bool success = dir != NULL && dir_remove (dir, filename);
+  struct inode *inode = NULL;
+  bool success;
+
+  /* Keep the inode open across the removal, so that a cached
+     executable image of it can be dropped afterward. */
+  if (dir != NULL)
+    dir_lookup (dir, filename, &inode);
+  success = dir != NULL && dir_remove (dir, filename);
+#ifdef USERPROG
+  if (success && inode != NULL)
+    process_forget_image (inode);
+#endif
+  inode_close (inode);
   dir_close (dir); 
 
   return success;
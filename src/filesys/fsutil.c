@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,8 +8,11 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "devices/disk.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profiler.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 
 /* List files in the root directory. */
@@ -195,3 +199,85 @@ fsutil_get (char **argv)
   file_close (src);
   free (buffer);
 }
+
+/* Creates file FILE_NAME, replacing any existing file of that
+   name, and writes HEADER_SIZE bytes from HEADER followed by
+   DATA_SIZE bytes from DATA into it. */
+static void
+save_file (const char *file_name, const void *header, off_t header_size,
+           const void *data, off_t data_size)
+{
+  struct file *dst;
+
+  filesys_remove (file_name);
+  if (!filesys_create (file_name, header_size + data_size, 0))
+    PANIC ("%s: create failed", file_name);
+  dst = filesys_open (file_name);
+  if (dst == NULL)
+    PANIC ("%s: open failed", file_name);
+  if (file_write (dst, header, header_size) != header_size
+      || file_write (dst, data, data_size) != data_size)
+    PANIC ("%s: write failed", file_name);
+  file_close (dst);
+}
+
+/* Saves the event trace gathered under the "-trace" option into
+   file FILE_NAME, replacing any existing file of that name.  The
+   file holds a struct trace_header followed by the records, and
+   can then be copied out with the `get' action.
+
+   Events that happen while the file is written, such as its own
+   disk writes, are not included. */
+void
+fsutil_trace (char **argv)
+{
+  const char *file_name = argv[1];
+  struct trace_header header;
+  struct trace_record *records;
+  size_t cnt;
+
+  printf ("Saving event trace into '%s'...\n", file_name);
+  if (!trace_enabled)
+    printf ("%s: warning: tracing is off (use -trace)\n", file_name);
+
+  records = malloc (TRACE_CNT * sizeof *records);
+  if (records == NULL)
+    PANIC ("couldn't allocate buffer");
+  cnt = trace_read (records, TRACE_CNT, &header.event_cnt);
+  memcpy (header.magic, "TRC", 4);
+  header.record_cnt = cnt;
+  header.timer_freq = TIMER_FREQ;
+  save_file (file_name, &header, sizeof header,
+             records, cnt * sizeof *records);
+  free (records);
+  printf ("Saved %zu of %"PRIu32" events.\n", cnt, header.event_cnt);
+}
+
+/* Saves the samples gathered under the "-prof" option into file
+   FILE_NAME, replacing any existing file of that name.  The file
+   holds a struct profiler_header followed by the samples, and can
+   then be copied out with the `get' action. */
+void
+fsutil_profile (char **argv)
+{
+  const char *file_name = argv[1];
+  struct profiler_header header;
+  struct profiler_sample *samples;
+  size_t cnt;
+
+  printf ("Saving profile into '%s'...\n", file_name);
+  if (profiler_hz == 0)
+    printf ("%s: warning: profiler is off (use -prof)\n", file_name);
+
+  samples = malloc (PROFILER_CNT * sizeof *samples);
+  if (samples == NULL)
+    PANIC ("couldn't allocate buffer");
+  cnt = profiler_read (samples, PROFILER_CNT, &header.interrupt_cnt);
+  memcpy (header.magic, "PRF", 4);
+  header.sample_cnt = cnt;
+  header.hz = profiler_hz;
+  save_file (file_name, &header, sizeof header,
+             samples, cnt * sizeof *samples);
+  free (samples);
+  printf ("Saved %zu of %"PRIu32" samples.\n", cnt, header.interrupt_cnt);
+}
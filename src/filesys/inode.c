@@ -1,4 +1,5 @@
 #include "filesys/inode.h"
+#include "threads/slab.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -62,11 +63,17 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Object cache for `struct inode'. */
+static struct slab_cache *inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  inode_cache = slab_cache_create ("inode", sizeof (struct inode), NULL);
+  if (inode_cache == NULL)
+    PANIC ("inode_init: can't create inode cache");
 }
 
 bool
@@ -235,7 +242,7 @@ inode_open (disk_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = slab_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -244,6 +251,7 @@ inode_open (disk_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->write_cnt = 0;
   inode->removed = false;
   disk_read (filesys_disk, inode->sector, &inode->data);
   return inode;
@@ -290,7 +298,7 @@ inode_close (struct inode *inode)
           release_inode_disk(&inode->data, bytes_to_sectors(inode->data.length));
         }
 
-      free (inode); 
+      slab_free (inode_cache, inode); 
     }
 }
 
@@ -303,6 +311,13 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Returns true if INODE has been removed with inode_remove(). */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
@@ -432,6 +447,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     }
   free (bounce);
 
+  if (bytes_written > 0)
+    inode->write_cnt++;
   return bytes_written;
 }
 
@@ -462,6 +479,15 @@ inode_length (const struct inode *inode)
   return inode->data.length;
 }
 
+/* Returns the number of writes to INODE since it was opened, so
+   that a cache of data derived from its contents can tell whether
+   the data is stale.  Meaningful only while INODE stays open. */
+unsigned
+inode_write_cnt (const struct inode *inode)
+{
+  return inode->write_cnt;
+}
+
 bool inode_isdir(struct inode *inode){
   return inode->data.isdir;
 }
\ No newline at end of file
@@ -18,6 +18,10 @@
 #define min(x,y) ((x)<(y) ? (x) : (y))
 #define max(x,y) ((x)>(y) ? (x) : (y))
 
+/* Largest file length the block index can address. */
+#define INODE_MAX_LENGTH ((NUM_OF_DIRECT_BLOCK + NUM_OF_INDIRECT_BLOCK \
+                           + sq (NUM_OF_INDIRECT_BLOCK)) * DISK_SECTOR_SIZE)
+
 struct bitmap;
 
 struct indirect_block_sector
@@ -45,6 +49,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned write_cnt;                 /* Number of writes that changed data. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -60,6 +65,8 @@ off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+unsigned inode_write_cnt (const struct inode *);
+bool inode_is_removed (const struct inode *);
 
 bool inode_isdir(struct inode *);
 
@@ -0,0 +1,43 @@
+#ifndef __LIB_CPUID_H
+#define __LIB_CPUID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* CPUID leaf 1 EDX feature bits. */
+#define CPUID_1_EDX_TSC (1u << 4)       /* Time-stamp counter. */
+#define CPUID_1_EDX_MSR (1u << 5)       /* RDMSR and WRMSR. */
+#define CPUID_1_EDX_SEP (1u << 11)      /* SYSENTER and SYSEXIT. */
+
+/* Executes CPUID with EAX = LEAF and stores the results. */
+static inline void
+cpuid (uint32_t leaf, uint32_t *eax, uint32_t *ebx,
+       uint32_t *ecx, uint32_t *edx) 
+{
+  asm volatile ("cpuid"
+                : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+                : "a" (leaf));
+}
+
+/* Returns true if the CPU supports sysenter and sysexit.  Early
+   Pentium Pro parts set the SEP bit without implementing the
+   instructions, so those are excluded, as Intel recommends.
+   Usable from both the kernel and user programs, so that the two
+   agree on whether the fast system call path is available. */
+static inline bool
+cpu_has_sysenter (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  cpuid (1, &eax, &ebx, &ecx, &edx);
+  if (!(edx & CPUID_1_EDX_SEP))
+    return false;
+
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  return !(family == 6 && model < 3 && stepping < 3);
+}
+
+#endif /* lib/cpuid.h */
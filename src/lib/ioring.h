@@ -0,0 +1,65 @@
+#ifndef __LIB_IORING_H
+#define __LIB_IORING_H
+
+#include <stdint.h>
+
+/* Layout of the asynchronous I/O ring shared between a user
+   process and the kernel.  ioring_setup() maps one page holding a
+   struct ioring into the process.  The process fills submission
+   entries and advances sq_tail; ioring_enter() hands them to the
+   kernel, whose worker threads carry them out and post one
+   completion entry each at cq_tail.  The process consumes
+   completions by advancing cq_head.
+
+   Indexes run freely and wrap modulo 2**32; an entry's slot is
+   its index modulo IORING_ENTRIES.  Each index is written by only
+   one side: the process owns sq_tail and cq_head, the kernel owns
+   sq_head and cq_tail. */
+
+/* Number of slots in each ring.  Must be a power of 2. */
+#define IORING_ENTRIES 64
+
+/* Largest buffer accepted by one read or write entry. */
+#define IORING_MAX_LEN (16 * 4096)
+
+/* Submission entry operations. */
+enum ioring_op
+  {
+    IORING_OP_NOP,              /* Completes with result 0. */
+    IORING_OP_READ,             /* Read LEN bytes at OFFSET into BUF. */
+    IORING_OP_WRITE,            /* Write LEN bytes at OFFSET from BUF. */
+    IORING_OP_OPEN,             /* Open file named by string BUF. */
+    IORING_OP_CLOSE,            /* Close FD. */
+    IORING_OP_FSYNC             /* Wait for earlier writes to reach disk. */
+  };
+
+/* Submission queue entry, filled in by the process. */
+struct ioring_sqe
+  {
+    uint32_t op;                /* An enum ioring_op. */
+    int32_t fd;                 /* File descriptor. */
+    void *buf;                  /* User buffer or file name. */
+    uint32_t len;               /* Buffer length in bytes. */
+    uint32_t offset;            /* File offset for read and write. */
+    uint32_t user_data;         /* Copied into the completion. */
+  };
+
+/* Completion queue entry, filled in by the kernel. */
+struct ioring_cqe
+  {
+    uint32_t user_data;         /* From the submission entry. */
+    int32_t res;                /* Bytes transferred, new fd, or -1. */
+  };
+
+/* The shared page. */
+struct ioring
+  {
+    volatile uint32_t sq_head;  /* Next entry the kernel will take. */
+    volatile uint32_t sq_tail;  /* Next free submission slot. */
+    volatile uint32_t cq_head;  /* Next completion to consume. */
+    volatile uint32_t cq_tail;  /* Next completion the kernel posts. */
+    struct ioring_sqe sq[IORING_ENTRIES];
+    struct ioring_cqe cq[IORING_ENTRIES];
+  };
+
+#endif /* lib/ioring.h */
@@ -3,6 +3,8 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -23,11 +25,21 @@ typedef unsigned long elem_type;
 
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   Two summary bitmaps, with one bit per element of BITS, let
+   searches skip whole elements without looking at them: bit K
+   of FULL is set if element K has every bit set, and bit K of
+   EMPTY is set if element K has no bit set.  One summary element
+   thus covers ELEM_BITS * ELEM_BITS bits, so even a bitmap for a
+   large disk is searched in a few summary elements.  Bits past
+   BIT_CNT in the last element are always 0. */
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
     elem_type *bits;    /* Elements that represent bits. */
+    elem_type *full;    /* Elements of BITS that are all 1s. */
+    elem_type *empty;   /* Elements of BITS that are all 0s. */
   };
 
 /* Returns the index of the element that contains the bit
@@ -60,6 +72,14 @@ byte_cnt (size_t bit_cnt)
   return sizeof (elem_type) * elem_cnt (bit_cnt);
 }
 
+/* Returns the number of bytes required for BIT_CNT bits and
+   their summaries. */
+static inline size_t
+storage_cnt (size_t bit_cnt)
+{
+  return byte_cnt (bit_cnt) + 2 * byte_cnt (elem_cnt (bit_cnt));
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type
@@ -69,6 +89,98 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a bit mask with the bits of the element containing
+   bit START that lie between START and END, exclusive, set to
+   1 and the rest set to 0. */
+static inline elem_type
+range_mask (size_t start, size_t end) 
+{
+  size_t elem_start = start - start % ELEM_BITS;
+  elem_type mask = (elem_type) -1 << (start % ELEM_BITS);
+  if (end - elem_start < ELEM_BITS)
+    mask &= ((elem_type) 1 << (end - elem_start)) - 1;
+  return mask;
+}
+
+/* Returns the index of the lowest 1 bit in WORD, which must not
+   be 0.  Compiles to a single BSF instruction. */
+static inline size_t
+first_set (elem_type word) 
+{
+  return __builtin_ctzl (word);
+}
+
+/* Returns the number of 1 bits in WORD, which is 32 bits wide
+   on the 80x86. */
+static inline size_t
+count_set (elem_type word) 
+{
+  word = word - ((word >> 1) & 0x55555555);
+  word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+  word = (word + (word >> 4)) & 0x0f0f0f0f;
+  return (word * 0x01010101) >> 24;
+}
+
+/* Brings the summary bits for element IDX of B up to date with
+   the element's contents. */
+static void
+summary_update (struct bitmap *b, size_t idx) 
+{
+  elem_type word = b->bits[idx];
+  elem_type all = (idx == elem_cnt (b->bit_cnt) - 1
+                   ? last_mask (b) : (elem_type) -1);
+  size_t summary_idx = elem_idx (idx);
+  elem_type mask = bit_mask (idx);
+
+  if (word == all)
+    b->full[summary_idx] |= mask;
+  else
+    b->full[summary_idx] &= ~mask;
+  if (word == 0)
+    b->empty[summary_idx] |= mask;
+  else
+    b->empty[summary_idx] &= ~mask;
+}
+
+/* Recomputes all of B's summary bits. */
+static void
+summary_rebuild (struct bitmap *b) 
+{
+  size_t i;
+
+  for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+    summary_update (b, i);
+}
+
+/* Sets the bits in MASK in element IDX of B to VALUE.
+   Interrupts are turned off so that the element and its summary
+   bits change together, which makes this atomic on a
+   uniprocessor machine. */
+static void
+elem_set (struct bitmap *b, size_t idx, elem_type mask, bool value) 
+{
+  enum intr_level old_level = intr_disable ();
+  if (value)
+    b->bits[idx] |= mask;
+  else
+    b->bits[idx] &= ~mask;
+  summary_update (b, idx);
+  intr_set_level (old_level);
+}
+
+/* Lays out B's bit and summary arrays in the BIT_CNT bits'
+   worth of storage at BITS and clears them all. */
+static void
+init_storage (struct bitmap *b, size_t bit_cnt, elem_type *bits) 
+{
+  b->bit_cnt = bit_cnt;
+  b->bits = bits;
+  b->full = b->bits + elem_cnt (bit_cnt);
+  b->empty = b->full + elem_cnt (elem_cnt (bit_cnt));
+  memset (b->bits, 0, storage_cnt (bit_cnt));
+  summary_rebuild (b);
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -81,11 +193,10 @@ bitmap_create (size_t bit_cnt)
   struct bitmap *b = malloc (sizeof *b);
   if (b != NULL)
     {
-      b->bit_cnt = bit_cnt;
-      b->bits = malloc (byte_cnt (bit_cnt));
-      if (b->bits != NULL || bit_cnt == 0)
+      elem_type *bits = malloc (storage_cnt (bit_cnt));
+      if (bits != NULL || bit_cnt == 0)
         {
-          bitmap_set_all (b, false);
+          init_storage (b, bit_cnt, bits);
           return b;
         }
       free (b);
@@ -103,9 +214,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
   
   ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
-  b->bit_cnt = bit_cnt;
-  b->bits = (elem_type *) (b + 1);
-  bitmap_set_all (b, false);
+  init_storage (b, bit_cnt, (elem_type *) (b + 1));
   return b;
 }
 
@@ -114,7 +223,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 size_t
 bitmap_buf_size (size_t bit_cnt) 
 {
-  return sizeof (struct bitmap) + byte_cnt (bit_cnt);
+  return sizeof (struct bitmap) + storage_cnt (bit_cnt);
 }
 
 /* Destroys bitmap B, freeing its storage.
@@ -157,26 +266,14 @@ bitmap_set (struct bitmap *b, size_t idx, bool value)
 void
 bitmap_mark (struct bitmap *b, size_t bit_idx) 
 {
-  size_t idx = elem_idx (bit_idx);
-  elem_type mask = bit_mask (bit_idx);
-
-  /* This is equivalent to `b->bits[idx] |= mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the OR instruction in [IA32-v2b]. */
-  asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  elem_set (b, elem_idx (bit_idx), bit_mask (bit_idx), true);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
 void
 bitmap_reset (struct bitmap *b, size_t bit_idx) 
 {
-  size_t idx = elem_idx (bit_idx);
-  elem_type mask = bit_mask (bit_idx);
-
-  /* This is equivalent to `b->bits[idx] &= ~mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the AND instruction in [IA32-v2a]. */
-  asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  elem_set (b, elem_idx (bit_idx), bit_mask (bit_idx), false);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -187,11 +284,11 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
 {
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
+  enum intr_level old_level = intr_disable ();
 
-  /* This is equivalent to `b->bits[idx] ^= mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the XOR instruction in [IA32-v2b]. */
-  asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  b->bits[idx] ^= mask;
+  summary_update (b, idx);
+  intr_set_level (old_level);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -214,18 +311,22 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, but not the whole range. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  while (start < end) 
+    {
+      elem_set (b, elem_idx (start), range_mask (start, end), value);
+      start = (elem_idx (start) + 1) * ELEM_BITS;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -233,17 +334,67 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t end = start + cnt;
+  size_t set_cnt = 0;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  while (start < end) 
+    {
+      set_cnt += count_set (b->bits[elem_idx (start)]
+                            & range_mask (start, end));
+      start = (elem_idx (start) + 1) * ELEM_BITS;
+    }
+  return value ? set_cnt : cnt - set_cnt;
+}
+
+/* Returns the index of the first element at or after IDX, and
+   before LIMIT, that has at least one bit set to VALUE according
+   to B's summary, or LIMIT if there is none. */
+static size_t
+next_elem (const struct bitmap *b, size_t idx, size_t limit, bool value) 
+{
+  const elem_type *skip = value ? b->empty : b->full;
+
+  while (idx < limit) 
+    {
+      size_t summary_idx = elem_idx (idx);
+      elem_type word = ~skip[summary_idx] & range_mask (idx, limit);
+      if (word != 0)
+        return summary_idx * ELEM_BITS + first_set (word);
+      idx = (summary_idx + 1) * ELEM_BITS;
+    }
+  return limit;
+}
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+   Elements with no bit set to VALUE are skipped using the
+   summary, without being read. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  size_t idx;
+  elem_type word;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx (start);
+  word = (value ? b->bits[idx] : ~b->bits[idx]) & range_mask (start, end);
+  while (word == 0) 
+    {
+      size_t limit = elem_cnt (end);
+      idx = next_elem (b, idx + 1, limit, value);
+      if (idx >= limit)
+        return end;
+      word = value ? b->bits[idx] : ~b->bits[idx];
+      if (idx == limit - 1)
+        word &= range_mask (idx * ELEM_BITS, end);
+    }
+  return idx * ELEM_BITS + first_set (word);
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -251,16 +402,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return next_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -299,13 +445,26 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 0)
+    return start;
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+      while (i <= last) 
+        {
+          /* Find the next bit set to VALUE, then the end of the
+             run it starts.  If the run is too short, resume the
+             search past it. */
+          size_t end;
+          i = next_bit (b, i, last + 1, value);
+          if (i > last)
+            break;
+          end = next_bit (b, i, i + cnt, !value);
+          if (end == i + cnt)
+            return i;
+          i = end;
+        }
     }
   return BITMAP_ERROR;
 }
@@ -347,6 +506,7 @@ bitmap_read (struct bitmap *b, struct file *file)
       off_t size = byte_cnt (b->bit_cnt);
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      summary_rebuild (b);
     }
   return success;
 }
@@ -9,15 +9,14 @@
 #include "../debug.h"
 #include "threads/malloc.h"
 
-#define list_elem_to_hash_elem(LIST_ELEM)                       \
-        list_entry(LIST_ELEM, struct hash_elem, list_elem)
-
-static struct list *find_bucket (struct hash *, struct hash_elem *);
-static struct hash_elem *find_elem (struct hash *, struct list *,
-                                    struct hash_elem *);
-static void insert_elem (struct hash *, struct list *, struct hash_elem *);
-static void remove_elem (struct hash *, struct hash_elem *);
+static struct hash_elem **find_link (struct hash *, struct hash_elem *);
+static void insert_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static void rehash_finish (struct hash *);
+
+/* Number of old buckets drained by each insertion or deletion
+   while the table is being resized. */
+#define REHASH_STEP 2
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -28,6 +27,9 @@ hash_init (struct hash *h,
   h->elem_cnt = 0;
   h->bucket_cnt = 4;
   h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->old_idx = 0;
   h->hash = hash;
   h->less = less;
   h->aux = aux;
@@ -41,6 +43,27 @@ hash_init (struct hash *h,
     return false;
 }
 
+/* Empties the CNT chains in BUCKETS, calling DESTRUCTOR, if it
+   is non-null, for each element, given auxiliary data AUX. */
+static void
+clear_buckets (struct hash_elem **buckets, size_t cnt,
+               hash_action_func *destructor, void *aux) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      if (destructor != NULL) 
+        while (buckets[i] != NULL) 
+          {
+            struct hash_elem *e = buckets[i];
+            buckets[i] = e->next;
+            destructor (e, aux);
+          }
+      buckets[i] = NULL;
+    }
+}
+
 /* Removes all the elements from H.
    
    If DESTRUCTOR is non-null, then it is called for each element
@@ -53,22 +76,14 @@ hash_init (struct hash *h,
 void
 hash_clear (struct hash *h, hash_action_func *destructor) 
 {
-  size_t i;
-
-  for (i = 0; i < h->bucket_cnt; i++) 
+  if (h->old_buckets != NULL) 
     {
-      struct list *bucket = &h->buckets[i];
-
-      if (destructor != NULL) 
-        while (!list_empty (bucket)) 
-          {
-            struct list_elem *list_elem = list_pop_front (bucket);
-            struct hash_elem *hash_elem = list_elem_to_hash_elem (list_elem);
-            destructor (hash_elem, h->aux);
-          }
-
-      list_init (bucket); 
-    }    
+      clear_buckets (h->old_buckets, h->old_bucket_cnt, destructor, h->aux);
+      free (h->old_buckets);
+      h->old_buckets = NULL;
+      h->old_bucket_cnt = 0;
+    }
+  clear_buckets (h->buckets, h->bucket_cnt, destructor, h->aux);
 
   h->elem_cnt = 0;
 }
@@ -88,6 +103,7 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 {
   if (destructor != NULL)
     hash_clear (h, destructor);
+  free (h->old_buckets);
   free (h->buckets);
 }
 
@@ -98,11 +114,10 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 struct hash_elem *
 hash_insert (struct hash *h, struct hash_elem *new)
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  struct hash_elem *old = *find_link (h, new);
 
   if (old == NULL) 
-    insert_elem (h, bucket, new);
+    insert_elem (h, new);
 
   rehash (h);
 
@@ -114,12 +129,15 @@ hash_insert (struct hash *h, struct hash_elem *new)
 struct hash_elem *
 hash_replace (struct hash *h, struct hash_elem *new) 
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  struct hash_elem **link = find_link (h, new);
+  struct hash_elem *old = *link;
 
   if (old != NULL)
-    remove_elem (h, old);
-  insert_elem (h, bucket, new);
+    {
+      *link = old->next;
+      h->elem_cnt--;
+    }
+  insert_elem (h, new);
 
   rehash (h);
 
@@ -131,7 +149,7 @@ hash_replace (struct hash *h, struct hash_elem *new)
 struct hash_elem *
 hash_find (struct hash *h, struct hash_elem *e) 
 {
-  return find_elem (h, find_bucket (h, e), e);
+  return *find_link (h, e);
 }
 
 /* Finds, removes, and returns an element equal to E in hash
@@ -144,10 +162,12 @@ hash_find (struct hash *h, struct hash_elem *e)
 struct hash_elem *
 hash_delete (struct hash *h, struct hash_elem *e)
 {
-  struct hash_elem *found = find_elem (h, find_bucket (h, e), e);
+  struct hash_elem **link = find_link (h, e);
+  struct hash_elem *found = *link;
   if (found != NULL) 
     {
-      remove_elem (h, found);
+      *link = found->next;
+      h->elem_cnt--;
       rehash (h); 
     }
   return found;
@@ -166,15 +186,15 @@ hash_apply (struct hash *h, hash_action_func *action)
   
   ASSERT (action != NULL);
 
+  rehash_finish (h);
   for (i = 0; i < h->bucket_cnt; i++) 
     {
-      struct list *bucket = &h->buckets[i];
-      struct list_elem *elem, *next;
+      struct hash_elem *e, *next;
 
-      for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
+      for (e = h->buckets[i]; e != NULL; e = next) 
         {
-          next = list_next (elem);
-          action (list_elem_to_hash_elem (elem), h->aux);
+          next = e->next;
+          action (e, h->aux);
         }
     }
 }
@@ -195,16 +215,18 @@ hash_apply (struct hash *h, hash_action_func *action)
    Modifying hash table H during iteration, using any of the
    functions hash_clear(), hash_destroy(), hash_insert(),
    hash_replace(), or hash_delete(), invalidates all
-   iterators. */
+   iterators.  Starting an iteration completes any resize in
+   progress. */
 void
 hash_first (struct hash_iterator *i, struct hash *h) 
 {
   ASSERT (i != NULL);
   ASSERT (h != NULL);
 
+  rehash_finish (h);
   i->hash = h;
-  i->bucket = i->hash->buckets;
-  i->elem = list_elem_to_hash_elem (list_head (i->bucket));
+  i->bucket = 0;
+  i->elem = NULL;
 }
 
 /* Advances I to the next element in the hash table and returns
@@ -218,18 +240,18 @@ hash_first (struct hash_iterator *i, struct hash *h)
 struct hash_elem *
 hash_next (struct hash_iterator *i)
 {
+  struct hash *h;
+
   ASSERT (i != NULL);
 
-  i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
-  while (i->elem == list_elem_to_hash_elem (list_end (i->bucket)))
-    {
-      if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt)
-        {
-          i->elem = NULL;
-          break;
-        }
-      i->elem = list_elem_to_hash_elem (list_begin (i->bucket));
-    }
+  h = i->hash;
+  if (i->elem != NULL)
+    i->elem = i->elem->next;
+  else if (i->bucket < h->bucket_cnt)
+    i->elem = h->buckets[i->bucket];
+  while (i->elem == NULL && i->bucket < h->bucket_cnt)
+    if (++i->bucket < h->bucket_cnt)
+      i->elem = h->buckets[i->bucket];
   
   return i->elem;
 }
@@ -294,85 +316,138 @@ hash_string (const char *s_)
   return hash;
 }
 
-/* Returns a hash of integer I. */
+/* Returns a hash of integer I.
+   This is the MurmurHash3 finalizer, which makes every bit of I
+   affect every bit of the hash.  Page-aligned addresses, whose
+   low bits are all zero, thus still spread over all buckets. */
 unsigned
 hash_int (int i) 
 {
-  return hash_bytes (&i, sizeof i);
+  unsigned hash = i;
+
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
 }
-
-/* Returns the bucket in H that E belongs in. */
-static struct list *
-find_bucket (struct hash *h, struct hash_elem *e) 
+
+/* Searches the chain in BUCKETS, an array of BUCKET_CNT chains,
+   that hash value HASH belongs in for an element equal to E.
+   Returns the link that points to the element if found, or to
+   the null pointer that ends the chain otherwise. */
+static struct hash_elem **
+search_chain (struct hash *h, struct hash_elem **buckets, size_t bucket_cnt,
+              unsigned hash, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  struct hash_elem **link;
+
+  for (link = &buckets[hash & (bucket_cnt - 1)]; *link != NULL;
+       link = &(*link)->next) 
+    {
+      struct hash_elem *hi = *link;
+      if (hi->hash == hash
+          && !h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
+        return link; 
+    }
+  return link;
 }
 
-/* Searches BUCKET in H for a hash element equal to E.  Returns
-   it if found or a null pointer otherwise. */
-static struct hash_elem *
-find_elem (struct hash *h, struct list *bucket, struct hash_elem *e) 
+/* Computes E's hash value, stores it in E, and searches H for an
+   element equal to E.  Returns the link that points to the
+   element if found.  Otherwise, returns the null link that ends
+   E's chain in H's current bucket array. */
+static struct hash_elem **
+find_link (struct hash *h, struct hash_elem *e) 
 {
-  struct list_elem *i;
+  struct hash_elem **link;
 
-  for (i = list_begin (bucket); i != list_end (bucket); i = list_next (i)) 
+  e->hash = h->hash (e, h->aux);
+  link = search_chain (h, h->buckets, h->bucket_cnt, e->hash, e);
+  if (*link == NULL && h->old_buckets != NULL) 
     {
-      struct hash_elem *hi = list_elem_to_hash_elem (i);
-      if (!h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
-        return hi; 
+      struct hash_elem **old_link = search_chain (h, h->old_buckets,
+                                                  h->old_bucket_cnt,
+                                                  e->hash, e);
+      if (*old_link != NULL)
+        return old_link;
     }
-  return NULL;
+  return link;
 }
 
-/* Returns X with its lowest-order bit set to 1 turned off. */
-static inline size_t
-turn_off_least_1bit (size_t x) 
+/* Element per bucket ratios. */
+#define MAX_ELEMS_PER_BUCKET  2 /* Elems/bucket > 2: double # of buckets. */
+#define MAX_BUCKETS_PER_ELEM  2 /* Buckets/elem > 2: halve # of buckets. */
+
+/* Moves up to CNT of H's old buckets into its current buckets,
+   freeing the old bucket array once it is empty. */
+static void
+rehash_step (struct hash *h, size_t cnt) 
 {
-  return x & (x - 1);
+  while (h->old_buckets != NULL && cnt-- > 0) 
+    {
+      struct hash_elem *e = h->old_buckets[h->old_idx];
+      while (e != NULL) 
+        {
+          struct hash_elem *next = e->next;
+          struct hash_elem **bucket
+            = &h->buckets[e->hash & (h->bucket_cnt - 1)];
+          e->next = *bucket;
+          *bucket = e;
+          e = next;
+        }
+      h->old_buckets[h->old_idx] = NULL;
+
+      if (++h->old_idx >= h->old_bucket_cnt) 
+        {
+          free (h->old_buckets);
+          h->old_buckets = NULL;
+          h->old_bucket_cnt = 0;
+        }
+    }
 }
 
-/* Returns true if X is a power of 2, otherwise false. */
-static inline size_t
-is_power_of_2 (size_t x) 
+/* Completes any resize of H in progress. */
+static void
+rehash_finish (struct hash *h) 
 {
-  return x != 0 && turn_off_least_1bit (x) == 0;
+  if (h->old_buckets != NULL)
+    rehash_step (h, h->old_bucket_cnt - h->old_idx);
 }
 
-/* Element per bucket ratios. */
-#define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
-#define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
-#define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
+/* Drains a few of H's old buckets, if it is being resized, or
+   starts a resize if H has too few or too many buckets for its
+   element count.  The bucket count doubles or halves and always
+   stays a power of 2, at least 4.
 
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
+   This function can fail because of an out-of-memory
    condition, but that'll just make hash accesses less efficient;
    we can still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
+  size_t new_bucket_cnt;
+  struct hash_elem **new_buckets;
   size_t i;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
-
-  /* Calculate the number of buckets to use now.
-     We want one bucket for about every BEST_ELEMS_PER_BUCKET.
-     We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
-  new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-  if (new_bucket_cnt < 4)
-    new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
-
-  /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
+  if (h->old_buckets != NULL) 
+    {
+      rehash_step (h, REHASH_STEP);
+      return;
+    }
+
+  /* Calculate the number of buckets to use now, allowing a
+     factor of 4 between the thresholds so that a table whose
+     size hovers near one is not resized back and forth. */
+  if (h->elem_cnt > h->bucket_cnt * MAX_ELEMS_PER_BUCKET)
+    new_bucket_cnt = h->bucket_cnt * 2;
+  else if (h->bucket_cnt > 4
+           && h->elem_cnt * MAX_BUCKETS_PER_ELEM < h->bucket_cnt)
+    new_bucket_cnt = h->bucket_cnt / 2;
+  else
     return;
 
   /* Allocate new buckets and initialize them as empty. */
@@ -385,46 +460,25 @@ rehash (struct hash *h)
       return;
     }
   for (i = 0; i < new_bucket_cnt; i++) 
-    list_init (&new_buckets[i]);
+    new_buckets[i] = NULL;
 
-  /* Install new bucket info. */
+  /* Install new bucket info and start draining the old. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->old_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
-
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
-    {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
-
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
-        {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
-        }
-    }
-
-  free (old_buckets);
+  rehash_step (h, REHASH_STEP);
 }
 
-/* Inserts E into BUCKET (in hash table H). */
+/* Inserts E, whose hash value is already cached, into the
+   current buckets of hash table H. */
 static void
-insert_elem (struct hash *h, struct list *bucket, struct hash_elem *e) 
+insert_elem (struct hash *h, struct hash_elem *e) 
 {
-  h->elem_cnt++;
-  list_push_front (bucket, &e->list_elem);
-}
+  struct hash_elem **bucket = &h->buckets[e->hash & (h->bucket_cnt - 1)];
 
-/* Removes E from hash table H. */
-static void
-remove_elem (struct hash *h, struct hash_elem *e) 
-{
-  h->elem_cnt--;
-  list_remove (&e->list_elem);
+  h->elem_cnt++;
+  e->next = *bucket;
+  *bucket = e;
 }
-
@@ -9,9 +9,18 @@
    This is a standard hash table with chaining.  To locate an
    element in the table, we compute a hash function over the
    element's data and use that as an index into an array of
-   doubly linked lists, then linearly search the list.
-
-   The chain lists do not use dynamic allocation.  Instead, each
+   singly linked chains, then linearly search the chain.  Each
+   element caches its hash value, so the comparison function is
+   only called on elements whose hash matches, and elements are
+   moved between buckets without being hashed again.
+
+   The table is resized incrementally.  When it grows or shrinks,
+   a new bucket array is allocated and the old one is drained a
+   few buckets at a time by later insertions and deletions, so no
+   single operation moves every element.  Until the old array is
+   empty, lookups search both arrays.
+
+   The chains do not use dynamic allocation.  Instead, each
    structure that can potentially be in a hash must embed a
    struct hash_elem member.  All of the hash functions operate on
    these `struct hash_elem's.  The hash_entry macro allows
@@ -23,12 +32,12 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include "list.h"
 
 /* Hash element. */
 struct hash_elem 
   {
-    struct list_elem list_elem;
+    struct hash_elem *next;     /* Next element in bucket. */
+    unsigned hash;              /* Cached hash value. */
   };
 
 /* Converts pointer to hash element HASH_ELEM into a pointer to
@@ -37,8 +46,8 @@ struct hash_elem
    of the hash element.  See the big comment at the top of the
    file for an example. */
 #define hash_entry(HASH_ELEM, STRUCT, MEMBER)                   \
-        ((STRUCT *) ((uint8_t *) &(HASH_ELEM)->list_elem        \
-                     - offsetof (STRUCT, MEMBER.list_elem)))
+        ((STRUCT *) ((uint8_t *) &(HASH_ELEM)->next             \
+                     - offsetof (STRUCT, MEMBER.next)))
 
 /* Computes and returns the hash value for hash element E, given
    auxiliary data AUX. */
@@ -60,7 +69,10 @@ struct hash
   {
     size_t elem_cnt;            /* Number of elements in table. */
     size_t bucket_cnt;          /* Number of buckets, a power of 2. */
-    struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    struct hash_elem **buckets; /* Array of `bucket_cnt' chains. */
+    struct hash_elem **old_buckets; /* Array being drained, or null. */
+    size_t old_bucket_cnt;      /* Number of buckets in `old_buckets'. */
+    size_t old_idx;             /* Next old bucket to drain. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
@@ -70,7 +82,7 @@ struct hash
 struct hash_iterator 
   {
     struct hash *hash;          /* The hash table. */
-    struct list *bucket;        /* Current bucket. */
+    size_t bucket;              /* Index of current bucket. */
     struct hash_elem *elem;     /* Current hash element in current bucket. */
   };
 
@@ -0,0 +1,46 @@
+#ifndef __LIB_LATENCY_H
+#define __LIB_LATENCY_H
+
+#include <stdint.h>
+
+/* Maximum length of a histogram's name, including the null
+   terminator. */
+#define LATENCY_NAME_MAX 16
+
+/* Number of buckets in a histogram.  Bucket 0 counts latencies
+   of 0 or 1 cycles, bucket I > 0 counts latencies in the range
+   [2**I, 2**(I+1)) cycles, and the last bucket also counts
+   everything longer. */
+#define LATENCY_BUCKETS 32
+
+/* Latency histogram of one kind of kernel operation, as kept by
+   the kernel and returned by the latency() system call.  Times
+   are in CPU cycles, as counted by the time-stamp counter. */
+struct latency_hist
+  {
+    char name[LATENCY_NAME_MAX];        /* Operation name. */
+    uint64_t total_cycles;              /* Sum of all latencies. */
+    uint64_t max_cycles;                /* Longest latency. */
+    uint32_t cnt;                       /* # of operations timed. */
+    uint32_t buckets[LATENCY_BUCKETS];  /* Counts by log2 latency. */
+  };
+
+/* Returns an upper bound on the PCT'th percentile latency in H,
+   that is, the end of the bucket holding it, or 0 if H is
+   empty. */
+static inline uint64_t
+latency_percentile (const struct latency_hist *h, unsigned pct)
+{
+  uint64_t seen = 0;
+  int i;
+
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    {
+      seen += h->buckets[i];
+      if (seen * 100 >= (uint64_t) h->cnt * pct && seen > 0)
+        return i < LATENCY_BUCKETS - 1 ? (uint64_t) 2 << i : h->max_cycles;
+    }
+  return 0;
+}
+
+#endif /* lib/latency.h */
@@ -0,0 +1,22 @@
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+#include <stdint.h>
+
+/* Maximum length of a profiled lock's name, including the null
+   terminator. */
+#define LOCKSTAT_NAME_MAX 16
+
+/* Contention statistics for one profiled kernel lock, as kept
+   by the kernel and returned by the lockstat() system call.
+   Times are in timer ticks. */
+struct lockstat 
+  {
+    char name[LOCKSTAT_NAME_MAX];       /* Lock name. */
+    uint32_t acquire_cnt;               /* # of acquisitions. */
+    uint32_t contended_cnt;             /* # of acquisitions that waited. */
+    int64_t wait_ticks;                 /* Total time spent waiting. */
+    int64_t max_hold_ticks;             /* Longest time held. */
+  };
+
+#endif /* lib/lockstat.h */
@@ -0,0 +1,30 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Values for getrusage()'s WHO argument. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Children that have been waited for. */
+
+/* Resources used by a thread, as kept by the kernel and returned
+   by the getrusage() system call.  Times are in timer ticks.
+   Swap-outs count against the owner of the evicted page; every
+   other counter is charged to the thread that did the work, so
+   the sectors written by a swap-out count against the thread
+   that needed a frame. */
+struct rusage
+  {
+    int64_t user_ticks;                 /* Ticks running user code. */
+    int64_t kernel_ticks;               /* Ticks running in the kernel. */
+    uint32_t major_faults;              /* Page faults that read a disk. */
+    uint32_t minor_faults;              /* Other resolved page faults. */
+    uint32_t swap_ins;                  /* Pages read from swap. */
+    uint32_t swap_outs;                 /* Pages written to swap. */
+    uint32_t sectors_read;              /* Disk sectors read. */
+    uint32_t sectors_written;           /* Disk sectors written. */
+    uint32_t voluntary_switches;        /* Switches away while blocking. */
+    uint32_t involuntary_switches;      /* Switches away while preempted. */
+  };
+
+#endif /* lib/rusage.h */
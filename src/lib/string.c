@@ -1,5 +1,78 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The block functions below move and compare 32-bit words where
+   they can.  x86 allows unaligned word accesses, so only the
+   destination is aligned; a source at a different alignment just
+   costs a little speed. */
+
+/* A 32-bit word that may alias any other type. */
+typedef uint32_t word_t __attribute__ ((__may_alias__));
+
+/* Blocks shorter than this are handled a byte at a time. */
+#define WORD_MIN 16
+
+/* Blocks at least this long are copied or filled with "rep movsl"
+   or "rep stosl" instead of a word loop. */
+#define REP_MIN 256
+
+/* Copies SIZE bytes forward from SRC to DST, lowest address first,
+   which is safe for overlapping blocks if DST <= SRC.  "rep movsl"
+   is used only if the blocks do not OVERLAP, since fast-string
+   microcode may store out of order. */
+static void
+copy_forward (unsigned char *dst, const unsigned char *src, size_t size,
+              bool overlap) 
+{
+  if (size >= WORD_MIN) 
+    {
+      size_t words;
+
+      /* Align DST. */
+      for (; ((uintptr_t) dst & 3) != 0; size--)
+        *dst++ = *src++;
+
+      words = size / 4;
+      size %= 4;
+      if (words * 4 >= REP_MIN && !overlap)
+        asm volatile ("rep movsl"
+                      : "+D" (dst), "+S" (src), "+c" (words)
+                      : : "memory");
+      else
+        for (; words > 0; words--, dst += 4, src += 4)
+          *(word_t *) dst = *(const word_t *) src;
+    }
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+/* Copies SIZE bytes backward from SRC to DST, highest address
+   first, which is safe for overlapping blocks if DST >= SRC. */
+static void
+copy_backward (unsigned char *dst, const unsigned char *src, size_t size) 
+{
+  dst += size;
+  src += size;
+  if (size >= WORD_MIN) 
+    {
+      size_t words;
+
+      /* Align the end of DST. */
+      for (; ((uintptr_t) dst & 3) != 0; size--)
+        *--dst = *--src;
+
+      for (words = size / 4, size %= 4; words > 0; words--) 
+        {
+          dst -= 4;
+          src -= 4;
+          *(word_t *) dst = *(const word_t *) src;
+        }
+    }
+  while (size-- > 0)
+    *--dst = *--src;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,9 +85,7 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
-
+  copy_forward (dst, src, size, false);
   return dst_;
 }
 
@@ -29,20 +100,14 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
-    {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
-    }
+  if (dst >= src + size || src >= dst + size)
+    copy_forward (dst, src, size, false);
+  else if (dst < src)
+    copy_forward (dst, src, size, true);
+  else if (dst > src)
+    copy_backward (dst, src, size);
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +123,10 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip equal words, then find the differing byte. */
+  for (; size >= 4; a += 4, b += 4, size -= 4)
+    if (*(const word_t *) a != *(const word_t *) b)
+      break;
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -282,10 +351,28 @@ memset (void *dst_, int value, size_t size)
 
   ASSERT (dst != NULL || size == 0);
 
-
-  while (size-- > 0){
+  if (size >= WORD_MIN) 
+    {
+      word_t word = (unsigned char) value * 0x01010101u;
+      size_t words;
+
+      /* Align DST. */
+      for (; ((uintptr_t) dst & 3) != 0; size--)
+        *dst++ = value;
+
+      words = size / 4;
+      size %= 4;
+      if (words * 4 >= REP_MIN)
+        asm volatile ("rep stosl"
+                      : "+D" (dst), "+c" (words)
+                      : "a" (word)
+                      : "memory");
+      else
+        for (; words > 0; words--, dst += 4)
+          *(word_t *) dst = word;
+    }
+  while (size-- > 0)
     *dst++ = value;
-  }
 
   return dst_;
 }
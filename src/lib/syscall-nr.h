@@ -28,7 +28,29 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Kernel statistics. */
+    SYS_LOCKSTAT,               /* Reads lock contention statistics. */
+
+    /* Positional and vectored I/O. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+
+    /* Asynchronous I/O. */
+    SYS_IORING_SETUP,           /* Map an asynchronous I/O ring. */
+    SYS_IORING_ENTER,           /* Submit and wait for ring entries. */
+
+    /* Resource limits. */
+    SYS_FDLIMIT,                /* Get or set the open file limit. */
+
+    /* Latency statistics. */
+    SYS_LATENCY,                /* Reads latency histograms. */
+
+    /* Resource usage. */
+    SYS_GETRUSAGE               /* Reads per-process resource usage. */
   };
 
 #endif /* lib/syscall-nr.h */
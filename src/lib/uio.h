@@ -0,0 +1,16 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer of a vectored read or write. */
+struct iovec 
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Most buffers accepted by one readv() or writev(). */
+#define IOV_MAX 32
+
+#endif /* lib/uio.h */
@@ -1,10 +1,15 @@
+#include <cpuid.h>
 #include <syscall.h>
 
 int main (int, char *[]);
 void _start (int argc, char *argv[]);
 
+/* In syscall.c. */
+extern bool syscall_fast;
+
 void
 _start (int argc, char *argv[]) 
 {
+  syscall_fast = cpu_has_sysenter ();
   exit (main (argc, argv));
 }
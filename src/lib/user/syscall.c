@@ -1,16 +1,30 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
 
+/* True if system calls should use sysenter instead of int $0x30.
+   Set by _start() when the CPU supports it, in which case the
+   kernel has set sysenter up too.  See userprog/syscall-entry.S. */
+bool syscall_fast;
+
+/* Enters the kernel with the system call number and arguments
+   on the stack, by sysenter if SYSCALL_FAST, otherwise by
+   int $0x30.  sysenter takes the stack pointer in %ecx and the
+   return address in %edx, so both are clobbered. */
+#define SYSCALL_TRAP                                            \
+        "cmpb $0, syscall_fast; je 1f; "                        \
+        "movl %%esp, %%ecx; movl $2f, %%edx; sysenter; "        \
+        "1: int $0x30; 2: "
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_TRAP "addl $4, %%esp"  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -20,11 +34,12 @@
         ({                                                               \
           int retval;                                                    \
           asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
+            ("pushl %[arg0]; pushl %[number]; "                          \
+             SYSCALL_TRAP "addl $8, %%esp"                               \
                : "=a" (retval)                                           \
                : [number] "i" (NUMBER),                                  \
                  [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
+               : "ecx", "edx", "memory");                                \
           retval;                                                        \
         })
 
@@ -35,12 +50,12 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP "addl $12, %%esp" \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -51,13 +66,32 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP "addl $16, %%esp" \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1),                             \
                  [arg2] "g" (ARG2)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "memory");                       \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; "                                  \
+             "pushl %[number]; " SYSCALL_TRAP "addl $20, %%esp" \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [arg1] "g" (ARG1),                             \
+                 [arg2] "g" (ARG2),                             \
+                 [arg3] "g" (ARG3)                              \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -182,3 +216,63 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+lockstat (struct lockstat *stats, int max_cnt)
+{
+  return syscall2 (SYS_LOCKSTAT, stats, max_cnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, length, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, length, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+struct ioring *
+ioring_setup (void)
+{
+  return (struct ioring *) syscall0 (SYS_IORING_SETUP);
+}
+
+int
+ioring_enter (unsigned to_submit, unsigned min_complete)
+{
+  return syscall2 (SYS_IORING_ENTER, to_submit, min_complete);
+}
+
+int
+fdlimit (int limit)
+{
+  return syscall1 (SYS_FDLIMIT, limit);
+}
+
+int
+latency (struct latency_hist *hists, int max_cnt)
+{
+  return syscall2 (SYS_LATENCY, hists, max_cnt);
+}
+
+int
+getrusage (int who, struct rusage *usage)
+{
+  return syscall2 (SYS_GETRUSAGE, who, usage);
+}
@@ -3,6 +3,11 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <latency.h>
+#include <lockstat.h>
+#include <rusage.h>
+#include <uio.h>
+#include <ioring.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +50,26 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Kernel statistics. */
+int lockstat (struct lockstat *, int max_cnt);
+
+/* Positional and vectored I/O. */
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+
+/* Asynchronous I/O. */
+struct ioring *ioring_setup (void);
+int ioring_enter (unsigned to_submit, unsigned min_complete);
+
+/* Resource limits. */
+int fdlimit (int limit);
+
+/* Latency statistics. */
+int latency (struct latency_hist *, int max_cnt);
+
+/* Resource usage. */
+int getrusage (int who, struct rusage *);
+
 #endif /* lib/user/syscall.h */
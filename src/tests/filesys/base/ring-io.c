@@ -0,0 +1,102 @@
+/* Sets up an asynchronous I/O ring, opens a file through it,
+   writes the file with a batch of write entries ended by an
+   fsync, reads it back with a batch of read entries, and closes
+   it through the ring, checking every completion. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 1000
+#define BLOCK_CNT 20
+#define TEST_SIZE (BLOCK_SIZE * BLOCK_CNT)
+
+static char buf[TEST_SIZE];
+static char buf2[TEST_SIZE];
+
+static struct ioring *ring;
+
+/* Queues an entry on the ring. */
+static void
+queue (enum ioring_op op, int fd, void *buffer, size_t len, size_t offset,
+       uint32_t user_data)
+{
+  struct ioring_sqe *sqe = &ring->sq[ring->sq_tail % IORING_ENTRIES];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buffer;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  ring->sq_tail++;
+}
+
+/* Takes the next completion from the ring, which must be for
+   USER_DATA, and returns its result. */
+static int
+reap (uint32_t user_data)
+{
+  struct ioring_cqe *cqe;
+
+  if (ring->cq_head == ring->cq_tail)
+    fail ("no completion for entry %u", (unsigned) user_data);
+  cqe = &ring->cq[ring->cq_head % IORING_ENTRIES];
+  if (cqe->user_data != user_data)
+    fail ("completion for entry %u, expected %u",
+          (unsigned) cqe->user_data, (unsigned) user_data);
+  ring->cq_head++;
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  const char *file_name = "ring";
+  int fd;
+  int i;
+
+  random_init (36);
+  random_bytes (buf, sizeof buf);
+
+  CHECK ((ring = ioring_setup ()) != NULL, "ioring_setup");
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+
+  queue (IORING_OP_OPEN, 0, (void *) file_name, 0, 0, 0);
+  CHECK (ioring_enter (1, 1) == 1, "submit open");
+  CHECK ((fd = reap (0)) > 1, "open \"%s\" through ring", file_name);
+
+  msg ("write \"%s\" through ring", file_name);
+  for (i = 0; i < BLOCK_CNT; i++)
+    queue (IORING_OP_WRITE, fd, buf + i * BLOCK_SIZE, BLOCK_SIZE,
+           i * BLOCK_SIZE, i);
+  queue (IORING_OP_FSYNC, fd, NULL, 0, 0, BLOCK_CNT);
+  if (ioring_enter (BLOCK_CNT + 1, BLOCK_CNT + 1) != BLOCK_CNT + 1)
+    fail ("write entries not all submitted");
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (reap (i) != BLOCK_SIZE)
+      fail ("write of block %d failed", i);
+  if (reap (BLOCK_CNT) != 0)
+    fail ("fsync failed");
+  if (filesize (fd) != TEST_SIZE)
+    fail ("file size is %d", filesize (fd));
+
+  msg ("read \"%s\" through ring", file_name);
+  for (i = BLOCK_CNT - 1; i >= 0; i--)
+    queue (IORING_OP_READ, fd, buf2 + i * BLOCK_SIZE, BLOCK_SIZE,
+           i * BLOCK_SIZE, i);
+  if (ioring_enter (BLOCK_CNT, BLOCK_CNT) != BLOCK_CNT)
+    fail ("read entries not all submitted");
+  for (i = BLOCK_CNT - 1; i >= 0; i--)
+    if (reap (i) != BLOCK_SIZE)
+      fail ("read of block %d failed", i);
+  compare_bytes (buf2, buf, TEST_SIZE, 0, file_name);
+
+  queue (IORING_OP_CLOSE, fd, NULL, 0, 0, 0);
+  queue (IORING_OP_READ, fd, buf2, 1, 0, 1);
+  ioring_enter (2, 2);
+  CHECK (reap (0) == 0, "close \"%s\" through ring", file_name);
+  CHECK (reap (1) == -1, "read of closed fd fails");
+}
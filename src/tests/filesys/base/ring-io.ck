@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ring-io) begin
+(ring-io) ioring_setup
+(ring-io) create "ring"
+(ring-io) submit open
+(ring-io) open "ring" through ring
+(ring-io) write "ring" through ring
+(ring-io) read "ring" through ring
+(ring-io) close "ring" through ring
+(ring-io) read of closed fd fails
+(ring-io) end
+EOF
+pass;
@@ -0,0 +1,86 @@
+/* Writes a file with pwrite() in random order and reads it back
+   with pread(), checking that neither moves the file position,
+   then rewrites and rereads it through differently split
+   iovecs with writev() and readv(). */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 512
+#define TEST_SIZE (512 * 40)
+#define BLOCK_CNT (TEST_SIZE / BLOCK_SIZE)
+
+static char buf[TEST_SIZE];
+static char buf2[TEST_SIZE];
+static int order[BLOCK_CNT];
+
+void
+test_main (void) 
+{
+  const char *file_name = "vector";
+  struct iovec iov[3];
+  int fd;
+  size_t i;
+
+  random_init (35);
+  random_bytes (buf, sizeof buf);
+  for (i = 0; i < BLOCK_CNT; i++)
+    order[i] = i;
+
+  CHECK (create (file_name, TEST_SIZE), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  msg ("pwrite \"%s\" in random order", file_name);
+  shuffle (order, BLOCK_CNT, sizeof *order);
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      size_t ofs = BLOCK_SIZE * order[i];
+      if (pwrite (fd, buf + ofs, BLOCK_SIZE, ofs) != BLOCK_SIZE)
+        fail ("pwrite %d bytes at offset %zu failed", (int) BLOCK_SIZE, ofs);
+    }
+
+  msg ("pread \"%s\" in random order", file_name);
+  shuffle (order, BLOCK_CNT, sizeof *order);
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      char block[BLOCK_SIZE];
+      size_t ofs = BLOCK_SIZE * order[i];
+      if (pread (fd, block, BLOCK_SIZE, ofs) != BLOCK_SIZE)
+        fail ("pread %d bytes at offset %zu failed", (int) BLOCK_SIZE, ofs);
+      compare_bytes (block, buf + ofs, BLOCK_SIZE, ofs, file_name);
+    }
+  if (tell (fd) != 0)
+    fail ("file position moved to %u", tell (fd));
+
+  msg ("writev \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 100;
+  iov[1].iov_base = buf + 100;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = buf + 100;
+  iov[2].iov_len = TEST_SIZE - 100;
+  if (writev (fd, iov, 3) != TEST_SIZE)
+    fail ("writev %d bytes failed", TEST_SIZE);
+  if (tell (fd) != TEST_SIZE)
+    fail ("file position is %u after writev", tell (fd));
+
+  msg ("readv \"%s\"", file_name);
+  seek (fd, 0);
+  iov[0].iov_base = buf2;
+  iov[0].iov_len = 5000;
+  iov[1].iov_base = buf2 + 5000;
+  iov[1].iov_len = 3;
+  iov[2].iov_base = buf2 + 5003;
+  iov[2].iov_len = TEST_SIZE - 5003;
+  if (readv (fd, iov, 3) != TEST_SIZE)
+    fail ("readv %d bytes failed", TEST_SIZE);
+  compare_bytes (buf2, buf, TEST_SIZE, 0, file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
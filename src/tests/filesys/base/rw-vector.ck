@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-vector) begin
+(rw-vector) create "vector"
+(rw-vector) open "vector"
+(rw-vector) pwrite "vector" in random order
+(rw-vector) pread "vector" in random order
+(rw-vector) writev "vector"
+(rw-vector) readv "vector"
+(rw-vector) close "vector"
+(rw-vector) end
+EOF
+pass;
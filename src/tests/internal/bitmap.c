@@ -0,0 +1,119 @@
+/* Test program for lib/kernel/bitmap.c.
+
+   Applies random operations to bitmaps of various sizes and
+   checks the results of bitmap_scan(), bitmap_count() and
+   bitmap_contains() against a plain array of bools searched
+   bit by bit.  Sizes straddle the point where the summary
+   bitmaps grow beyond one element.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Largest bitmap tested. */
+#define MAX_BITS 4500
+
+/* Operations applied to each bitmap. */
+#define OP_CNT 500
+
+static bool ref[MAX_BITS];
+
+/* Returns the start of the first run of CNT bits set to VALUE
+   in REF[0...BIT_CNT) at or after START, or BITMAP_ERROR. */
+static size_t
+ref_scan (size_t bit_cnt, size_t start, size_t cnt, bool value)
+{
+  size_t i, j;
+
+  for (i = start; i + cnt <= bit_cnt; i++)
+    {
+      for (j = 0; j < cnt && ref[i + j] == value; j++)
+        continue;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Applies OP_CNT random operations to a bitmap of BIT_CNT bits
+   whose bits are true with probability DENSITY percent. */
+static void
+test_size (size_t bit_cnt, int density)
+{
+  struct bitmap *b = bitmap_create (bit_cnt);
+  size_t i, op;
+
+  ASSERT (b != NULL);
+  for (i = 0; i < bit_cnt; i++)
+    ref[i] = false;
+
+  for (op = 0; op < OP_CNT; op++)
+    {
+      size_t start = random_ulong () % (bit_cnt + 1);
+      size_t cnt = random_ulong () % (bit_cnt - start + 1);
+      bool value = (int) (random_ulong () % 100) < density;
+      size_t expected;
+
+      switch (random_ulong () % 5)
+        {
+        case 0:
+          bitmap_set_multiple (b, start, cnt, value);
+          for (i = start; i < start + cnt; i++)
+            ref[i] = value;
+          break;
+
+        case 1:
+          if (start < bit_cnt)
+            {
+              bitmap_flip (b, start);
+              ref[start] = !ref[start];
+            }
+          break;
+
+        case 2:
+          for (expected = 0, i = start; i < start + cnt; i++)
+            expected += ref[i] == value;
+          ASSERT (bitmap_count (b, start, cnt, value) == expected);
+          ASSERT (bitmap_contains (b, start, cnt, value) == (expected > 0));
+          break;
+
+        default:
+          /* Mostly short runs, as allocators ask for. */
+          cnt = random_ulong () % 8 ? random_ulong () % 5
+                                    : random_ulong () % (bit_cnt + 2);
+          ASSERT (bitmap_scan (b, start, cnt, value)
+                  == ref_scan (bit_cnt, start, cnt, value));
+          break;
+        }
+    }
+
+  for (i = 0; i < bit_cnt; i++)
+    ASSERT (bitmap_test (b, i) == ref[i]);
+  bitmap_destroy (b);
+}
+
+void
+test (void)
+{
+  static const size_t sizes[] = {0, 1, 31, 32, 33, 64, 1023, 1024, 1025,
+                                 MAX_BITS};
+  size_t i;
+  int density;
+
+  printf ("testing various size bitmaps:");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      for (density = 0; density <= 100; density += 10)
+        test_size (sizes[i], density);
+      printf (" %zu", sizes[i]);
+    }
+  printf (" done\n");
+  printf ("bitmap: PASS\n");
+}
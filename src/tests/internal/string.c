@@ -0,0 +1,218 @@
+/* Test program and microbenchmark for the block functions in
+   lib/string.c.
+
+   Checks memcpy(), memmove(), memset() and memcmp() against
+   simple byte loops over a range of sizes, alignments and, for
+   memmove(), overlaps.  Then times each function against its byte
+   loop across sizes and prints the timer ticks taken by each.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Largest block tested. */
+#define MAX_SIZE 4096
+
+/* Bytes copied or set by each timing run. */
+#define BENCH_BYTES (4 * 1024 * 1024)
+
+static unsigned char buf_a[MAX_SIZE + 64];
+static unsigned char buf_b[MAX_SIZE + 64];
+static unsigned char ref[MAX_SIZE + 64];
+
+/* Keeps memcmp() results live in timing runs. */
+static volatile int sink;
+
+/* Reference byte loops. */
+
+static void
+byte_memcpy (void *dst_, const void *src_, size_t size) 
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+static void
+byte_memmove (void *dst_, const void *src_, size_t size) 
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  if (dst < src) 
+    while (size-- > 0)
+      *dst++ = *src++;
+  else 
+    {
+      dst += size;
+      src += size;
+      while (size-- > 0)
+        *--dst = *--src;
+    }
+}
+
+static void
+byte_memset (void *dst_, int value, size_t size) 
+{
+  unsigned char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+static int
+byte_memcmp (const void *a_, const void *b_, size_t size) 
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static int
+sign (int x) 
+{
+  return (x > 0) - (x < 0);
+}
+
+/* Checks each function at SIZE bytes with the given destination
+   and source alignments. */
+static void
+verify (size_t size, size_t dst_ofs, size_t src_ofs) 
+{
+  size_t shift;
+
+  /* memcpy. */
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+  memcpy (ref, buf_b, sizeof ref);
+  byte_memcpy (ref + dst_ofs, buf_a + src_ofs, size);
+  ASSERT (memcpy (buf_b + dst_ofs, buf_a + src_ofs, size) == buf_b + dst_ofs);
+  ASSERT (byte_memcmp (buf_b, ref, sizeof ref) == 0);
+
+  /* memset. */
+  byte_memset (ref + dst_ofs, 0xa5, size);
+  ASSERT (memset (buf_b + dst_ofs, 0xa5, size) == buf_b + dst_ofs);
+  ASSERT (byte_memcmp (buf_b, ref, sizeof ref) == 0);
+
+  /* memcmp, equal and with one byte changed. */
+  ASSERT (memcmp (buf_b + dst_ofs, ref + dst_ofs, size) == 0);
+  if (size > 0)
+    {
+      size_t pos = random_ulong () % size;
+      ref[dst_ofs + pos] ^= 1 << (random_ulong () % 8);
+      ASSERT (sign (memcmp (buf_b + dst_ofs, ref + dst_ofs, size))
+              == byte_memcmp (buf_b + dst_ofs, ref + dst_ofs, size));
+    }
+
+  /* memmove, overlapping in both directions. */
+  for (shift = 0; shift <= 9; shift += 3)
+    {
+      random_bytes (buf_a, sizeof buf_a);
+      memcpy (ref, buf_a, sizeof ref);
+      byte_memmove (ref + dst_ofs, ref + dst_ofs + shift, size);
+      ASSERT (memmove (buf_a + dst_ofs, buf_a + dst_ofs + shift, size)
+              == buf_a + dst_ofs);
+      ASSERT (byte_memcmp (buf_a, ref, sizeof ref) == 0);
+
+      byte_memmove (ref + src_ofs + shift, ref + src_ofs, size);
+      memmove (buf_a + src_ofs + shift, buf_a + src_ofs, size);
+      ASSERT (byte_memcmp (buf_a, ref, sizeof ref) == 0);
+    }
+}
+
+/* Returns the ticks taken to move BENCH_BYTES bytes SIZE at a
+   time with the function selected by WHICH, using the byte loop
+   if BYTES is true. */
+static int64_t
+time_run (int which, bool bytes, size_t size) 
+{
+  size_t cnt = BENCH_BYTES / size;
+  int64_t start = timer_ticks ();
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    switch (which)
+      {
+      case 0:
+        if (bytes)
+          byte_memcpy (buf_b, buf_a, size);
+        else
+          memcpy (buf_b, buf_a, size);
+        break;
+      case 1:
+        if (bytes)
+          byte_memmove (buf_b + 1, buf_b, size);
+        else
+          memmove (buf_b + 1, buf_b, size);
+        break;
+      case 2:
+        if (bytes)
+          byte_memset (buf_b, i, size);
+        else
+          memset (buf_b, i, size);
+        break;
+      case 3:
+        if (bytes)
+          sink = byte_memcmp (buf_b, buf_a, size);
+        else
+          sink = memcmp (buf_b, buf_a, size);
+        break;
+      }
+  return timer_elapsed (start);
+}
+
+void
+test (void) 
+{
+  static const char *names[] = {"memcpy", "memmove", "memset", "memcmp"};
+  static const size_t sizes[] = {4, 16, 64, 256, 1024, 4096};
+  size_t size, i;
+  int dst_ofs, src_ofs, which;
+
+  printf ("verifying sizes 0 to 300 and 4096:");
+  for (size = 0; size <= 300 || size == MAX_SIZE; size++) 
+    {
+      for (dst_ofs = 0; dst_ofs < 4; dst_ofs++)
+        for (src_ofs = 0; src_ofs < 4; src_ofs++)
+          verify (size, dst_ofs, src_ofs);
+      if (size == 300)
+        size = MAX_SIZE - 1;
+    }
+  printf (" done\n");
+
+  /* Equal blocks, so memcmp() runs to the end. */
+  memset (buf_a, 0x5a, sizeof buf_a);
+  memset (buf_b, 0x5a, sizeof buf_b);
+
+  printf ("ticks to process %d bytes, byte loop / lib/string.c:\n",
+          BENCH_BYTES);
+  printf ("%8s", "size");
+  for (which = 0; which < 4; which++)
+    printf (" %15s", names[which]);
+  printf ("\n");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      printf ("%8zu", sizes[i]);
+      for (which = 0; which < 4; which++)
+        printf ("    %5"PRId64" / %4"PRId64,
+                time_run (which, true, sizes[i]),
+                time_run (which, false, sizes[i]));
+      printf ("\n");
+    }
+  printf ("string: PASS\n");
+}
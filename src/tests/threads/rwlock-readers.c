@@ -0,0 +1,100 @@
+/* Measures how well readers of a reader-writer lock overlap.
+
+   For each reader count, starts that many threads that each hold
+   the lock for SLEEP_TICKS timer ticks, first for reading and
+   then for writing, and reports the elapsed time of each run.
+   Shared readers should all finish in about SLEEP_TICKS ticks no
+   matter how many there are, while exclusive holders take about
+   SLEEP_TICKS ticks apiece. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks each thread holds the lock. */
+#define SLEEP_TICKS 10
+
+/* Largest number of concurrent readers tried. */
+#define MAX_READERS 8
+
+struct rwlock_test 
+  {
+    struct rwlock rw;           /* Lock under test. */
+    bool exclusive;             /* Acquire for writing instead of reading? */
+    struct semaphore done;      /* Upped by each thread when it finishes. */
+  };
+
+static thread_func reader_thread;
+static int64_t run_readers (struct rwlock_test *, int reader_cnt,
+                            bool exclusive);
+
+void
+test_rwlock_readers (void) 
+{
+  struct rwlock_test test;
+  int reader_cnt;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&test.rw);
+  sema_init (&test.done, 0);
+
+  for (reader_cnt = 1; reader_cnt <= MAX_READERS; reader_cnt *= 2)
+    {
+      int64_t shared = run_readers (&test, reader_cnt, false);
+      int64_t exclusive = run_readers (&test, reader_cnt, true);
+
+      msg ("%d readers: %lld ticks shared, %lld ticks exclusive",
+           reader_cnt, shared, exclusive);
+      if (reader_cnt > 1 && shared >= exclusive)
+        fail ("%d shared readers did not overlap", reader_cnt);
+    }
+
+  pass ();
+}
+
+/* Runs READER_CNT threads against TEST's lock, each acquiring it
+   for writing if EXCLUSIVE is true or for reading otherwise, and
+   returns the number of ticks until all of them are done. */
+static int64_t
+run_readers (struct rwlock_test *test, int reader_cnt, bool exclusive) 
+{
+  int64_t start;
+  int i;
+
+  test->exclusive = exclusive;
+  start = timer_ticks ();
+  for (i = 0; i < reader_cnt; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, test);
+    }
+  for (i = 0; i < reader_cnt; i++)
+    sema_down (&test->done);
+  return timer_elapsed (start);
+}
+
+static void
+reader_thread (void *test_) 
+{
+  struct rwlock_test *test = test_;
+
+  if (test->exclusive)
+    {
+      rwlock_acquire_write (&test->rw);
+      timer_sleep (SLEEP_TICKS);
+      rwlock_release_write (&test->rw);
+    }
+  else
+    {
+      rwlock_acquire_read (&test->rw);
+      timer_sleep (SLEEP_TICKS);
+      rwlock_release_read (&test->rw);
+    }
+  sema_up (&test->done);
+}
@@ -0,0 +1,62 @@
+/* Opens "sample.txt" until the open file limit is reached,
+   checking that a closed descriptor is the next one reused, then
+   raises the limit with fdlimit() and opens past the old one. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NEW_LIMIT 300
+
+static int fds[NEW_LIMIT];
+
+/* Opens "sample.txt" until open() fails and returns the number
+   of files opened. */
+static int
+open_all (void) 
+{
+  int cnt = 0;
+
+  while (cnt < NEW_LIMIT && (fds[cnt] = open ("sample.txt")) > 1)
+    cnt++;
+  if (cnt < NEW_LIMIT && open ("sample.txt") != -1)
+    fail ("open succeeded past the limit");
+  return cnt;
+}
+
+/* Closes the CNT files opened by open_all(). */
+static void
+close_all (int cnt) 
+{
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    close (fds[i]);
+}
+
+void
+test_main (void) 
+{
+  int limit, cnt, fd;
+
+  limit = fdlimit (0);
+  msg ("limit is %d", limit);
+  cnt = open_all ();
+  if (cnt != limit)
+    fail ("opened %d files, expected %d", cnt, limit);
+  msg ("opened %d files", cnt);
+
+  close (fds[10]);
+  CHECK ((fd = open ("sample.txt")) == fds[10], "lowest free fd is reused");
+
+  CHECK (fdlimit (limit / 2) == -1, "can't lower limit below open fds");
+  close_all (cnt);
+
+  CHECK (fdlimit (NEW_LIMIT) == limit, "raise limit to %d", NEW_LIMIT);
+  cnt = open_all ();
+  if (cnt != NEW_LIMIT)
+    fail ("opened %d files, expected %d", cnt, NEW_LIMIT);
+  CHECK (open ("sample.txt") == -1, "open past new limit fails");
+  msg ("opened %d files", cnt);
+  close_all (cnt);
+}
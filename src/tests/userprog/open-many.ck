@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) limit is 128
+(open-many) opened 128 files
+(open-many) lowest free fd is reused
+(open-many) can't lower limit below open fds
+(open-many) raise limit to 300
+(open-many) open past new limit fails
+(open-many) opened 300 files
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
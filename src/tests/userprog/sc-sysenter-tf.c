@@ -0,0 +1,37 @@
+/* Sets the trap flag, which makes the CPU single-step, and then
+   invokes a system call with sysenter.  sysenter leaves the trap
+   flag set, so the CPU takes a debug exception at the kernel's
+   sysenter entry point.  The kernel must shrug that off rather
+   than panic, carry out the system call, and return with
+   single-stepping off, so that the process runs on normally. */
+
+#include <cpuid.h>
+#include <stdio.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char text[] = "sysenter with TF set\n";
+  int retval;
+
+  if (!cpu_has_sysenter ())
+    {
+      msg ("sysenter not supported");
+      return;
+    }
+
+  /* Nothing may come between popfl, which sets TF, and sysenter,
+     or the CPU would single-step it in user mode. */
+  asm volatile ("pushl %[size]; pushl %[buf]; pushl %[fd]; "
+                "pushl %[number]; movl $1f, %%edx; pushfl; "
+                "orl $0x100, (%%esp); leal 4(%%esp), %%ecx; popfl; "
+                "sysenter; 1: addl $16, %%esp"
+                : "=a" (retval)
+                : [number] "i" (SYS_WRITE), [fd] "i" (STDOUT_FILENO),
+                  [buf] "r" (text), [size] "i" (sizeof text - 1)
+                : "ecx", "edx", "memory", "cc");
+  msg ("write returned %d", retval);
+}
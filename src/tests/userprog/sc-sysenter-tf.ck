@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(sc-sysenter-tf) begin
+sysenter with TF set
+(sc-sysenter-tf) write returned 21
+(sc-sysenter-tf) end
+sc-sysenter-tf: exit(0)
+EOF
+(sc-sysenter-tf) begin
+(sc-sysenter-tf) sysenter not supported
+(sc-sysenter-tf) end
+sc-sysenter-tf: exit(0)
+EOF
+pass;
@@ -0,0 +1,36 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdint.h>
+
+/* Model-specific registers. */
+#define MSR_SYSENTER_CS  0x174  /* Code selector loaded by sysenter. */
+#define MSR_SYSENTER_ESP 0x175  /* Stack pointer loaded by sysenter. */
+#define MSR_SYSENTER_EIP 0x176  /* Entry point jumped to by sysenter. */
+
+/* Reads model-specific register MSR. */
+static inline uint64_t
+rdmsr (uint32_t msr) 
+{
+  uint64_t value;
+  asm volatile ("rdmsr" : "=A" (value) : "c" (msr));
+  return value;
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint64_t value) 
+{
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+/* Returns the time-stamp counter, which counts CPU cycles. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t value;
+  asm volatile ("rdtsc" : "=A" (value));
+  return value;
+}
+
+#endif /* threads/cpu.h */
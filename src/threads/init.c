@@ -15,15 +15,21 @@
 #include "devices/vga.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/latency.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profiler.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/ioring.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
@@ -34,6 +40,8 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/vma.h"
 #include "vm/swap.h"
 #endif
 
@@ -80,6 +88,9 @@ main (void)
   /* Initialize ourselves as a thread so we can use locks,
      then enable console locking. */
   thread_init ();
+  lock_profile_init ();
+  latency_init ();
+  trace_init ();
   console_init ();  
 
   /* Greet user. */
@@ -88,6 +99,7 @@ main (void)
   /* Initialize memory system. */
   palloc_init ();
   malloc_init ();
+  slab_init ();
   paging_init ();
 
   /* Segmentation. */
@@ -104,11 +116,16 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   is_thread_system_ready = 1;
   frame_init();
+#ifdef FILESYS
+  page_table_init();
+  vma_init();
+#endif
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
@@ -119,6 +136,9 @@ main (void)
   filesys_init (format_filesys);
   
   swap_init();
+#endif
+#ifdef USERPROG
+  ioring_init ();
 #endif
   printf ("Boot complete.\n");
   /* Run actions specified on kernel command line. */
@@ -248,6 +268,14 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-lockprof"))
+        lock_profiling = true;
+      else if (!strcmp (name, "-latency"))
+        latency_profiling = true;
+      else if (!strcmp (name, "-prof"))
+        profiler_enable (value != NULL ? atoi (value) : TIMER_FREQ);
+      else if (!strcmp (name, "-trace"))
+        trace_enabled = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -297,6 +325,8 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"put", 2, fsutil_put},
       {"get", 2, fsutil_get},
+      {"trace", 2, fsutil_trace},
+      {"profile", 2, fsutil_profile},
 #endif
       {NULL, 0, NULL},
     };
@@ -346,6 +376,8 @@ usage (void)
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  put FILE           Put FILE into file system from scratch disk.\n"
           "  get FILE           Get FILE from file system into scratch disk.\n"
+          "  trace FILE         Save the -trace event buffer into FILE.\n"
+          "  profile FILE       Save the -prof samples into FILE.\n"
 #endif
           "\nOptions:\n"
           "  -h                 Print this help message and power off.\n"
@@ -353,6 +385,10 @@ usage (void)
           "  -f                 Format file system disk during startup.\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -lockprof          Gather lock contention statistics.\n"
+          "  -latency           Gather system call and page fault latencies.\n"
+          "  -trace             Record kernel events for the trace action.\n"
+          "  -prof[=HZ]         Sample the running code HZ times per second.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -391,6 +427,10 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  lock_print_stats ();
+  latency_print_stats ();
+  palloc_print_stats ();
+  slab_print_stats ();
 #ifdef FILESYS
   disk_print_stats ();
 #endif
@@ -0,0 +1,113 @@
+#include "threads/latency.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* If true, latency_record() updates histograms.  Controlled by
+   kernel command-line option "-latency". */
+bool latency_profiling;
+
+/* List of registered `struct latency_profile's. */
+static struct list profiles;
+
+/* Initializes the list of latency profiles. */
+void
+latency_init (void)
+{
+  list_init (&profiles);
+}
+
+/* Registers PROFILE, which must stay valid from now on, to keep
+   the latency histogram of the operation called NAME. */
+void
+latency_profile (struct latency_profile *profile, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (profile != NULL);
+  ASSERT (name != NULL);
+
+  memset (profile, 0, sizeof *profile);
+  strlcpy (profile->hist.name, name, sizeof profile->hist.name);
+
+  old_level = intr_disable ();
+  list_push_back (&profiles, &profile->elem);
+  intr_set_level (old_level);
+}
+
+/* Records in PROFILE an operation that began when rdtsc()
+   returned START and has just finished. */
+void
+latency_record (struct latency_profile *profile, uint64_t start)
+{
+  struct latency_hist *h = &profile->hist;
+  enum intr_level old_level;
+  uint64_t cycles;
+  int bucket;
+
+  if (!latency_profiling)
+    return;
+
+  cycles = rdtsc () - start;
+  if (cycles >> 32 != 0)
+    bucket = LATENCY_BUCKETS - 1;
+  else
+    {
+      bucket = 31 - __builtin_clz ((uint32_t) cycles | 1);
+      if (bucket > LATENCY_BUCKETS - 1)
+        bucket = LATENCY_BUCKETS - 1;
+    }
+
+  old_level = intr_disable ();
+  h->cnt++;
+  h->buckets[bucket]++;
+  h->total_cycles += cycles;
+  if (cycles > h->max_cycles)
+    h->max_cycles = cycles;
+  intr_set_level (old_level);
+}
+
+/* Copies the histograms of up to MAX_CNT latency profiles into
+   HISTS and returns the number copied. */
+int
+latency_read (struct latency_hist *hists, int max_cnt)
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  int cnt = 0;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&profiles);
+       e != list_end (&profiles) && cnt < max_cnt; e = list_next (e))
+    hists[cnt++] = list_entry (e, struct latency_profile, elem)->hist;
+  intr_set_level (old_level);
+  return cnt;
+}
+
+/* Prints count, mean, median, 99th percentile and maximum
+   latency of each profiled operation that has happened. */
+void
+latency_print_stats (void)
+{
+  struct list_elem *e;
+
+  if (!latency_profiling)
+    return;
+
+  for (e = list_begin (&profiles); e != list_end (&profiles);
+       e = list_next (e))
+    {
+      struct latency_hist *h = &list_entry (e, struct latency_profile,
+                                            elem)->hist;
+      if (h->cnt == 0)
+        continue;
+      printf ("Latency %s: %"PRIu32" ops, mean %"PRIu64", p50 <%"PRIu64", "
+              "p99 <%"PRIu64", max %"PRIu64" cycles\n",
+              h->name, h->cnt, h->total_cycles / h->cnt,
+              latency_percentile (h, 50), latency_percentile (h, 99),
+              h->max_cycles);
+    }
+}
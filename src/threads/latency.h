@@ -0,0 +1,25 @@
+#ifndef THREADS_LATENCY_H
+#define THREADS_LATENCY_H
+
+#include <latency.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Latency profile of a named kernel operation.  Only gathered
+   while latency_profiling is true (kernel option "-latency"). */
+struct latency_profile
+  {
+    struct latency_hist hist;   /* Histogram gathered so far. */
+    struct list_elem elem;      /* Element in list of profiles. */
+  };
+
+extern bool latency_profiling;
+
+void latency_init (void);
+void latency_profile (struct latency_profile *, const char *name);
+void latency_record (struct latency_profile *, uint64_t start);
+int latency_read (struct latency_hist *, int max_cnt);
+void latency_print_stats (void);
+
+#endif /* threads/latency.h */
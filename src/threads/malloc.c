@@ -7,26 +7,37 @@
 #include <string.h>
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
    The size of each request, in bytes, is rounded up to a power
    of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   that size.  The descriptor keeps a list of arenas that have
+   free blocks.  If the list is nonempty, a block is taken from
+   its first arena to satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
    malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   into blocks, all of which are put on the arena's own free
+   list, and the arena is added to the descriptor's list.  Then
+   we return one of the new blocks.
+
+   When we free a block, we add it to its arena's free list.  If
+   the arena now has no in-use blocks, we take it off the
+   descriptor's list and give it back to the page allocator.
+   Because each arena owns its free blocks, this does not require
+   looking at the blocks themselves.
+
+   To cut down on traffic on the descriptor locks, each thread
+   keeps a small "magazine" of free blocks for every descriptor.
+   malloc() and free() use the running thread's magazine without
+   locking, since no other thread touches it.  An empty magazine
+   is refilled, and a full one partially flushed, in batches of
+   several blocks under a single acquisition of the descriptor
+   lock.  A thread flushes its magazines when it exits.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -34,13 +45,21 @@
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Most bytes' worth of blocks a magazine may hold, and the most
+   blocks it may hold regardless of size. */
+#define MAGAZINE_BYTES 1024
+#define MAGAZINE_MAX 16
+
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
-    struct list free_list;      /* List of free blocks. */
+    size_t magazine_size;       /* Capacity of a thread's magazine. */
+    size_t batch_size;          /* Blocks moved per refill or flush. */
+    struct list arena_list;     /* Arenas with free blocks. */
     struct lock lock;           /* Lock. */
+    struct lock_profile profile; /* Contention statistics for LOCK. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -52,26 +71,31 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct block *free_list;    /* Free blocks in this arena. */
+    struct list_elem elem;      /* Element in descriptor's arena list. */
   };
 
 /* Free block. */
 struct block 
   {
-    struct list_elem free_elem; /* Free list element. */
+    struct block *next;         /* Next free block. */
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_DESC_MAX]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static bool magazine_refill (struct desc *, struct magazine *);
+static void magazine_flush (struct desc *, struct magazine *, size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
   size_t block_size;
+  char name[LOCKSTAT_NAME_MAX];
 
   for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
     {
@@ -79,8 +103,16 @@ malloc_init (void)
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
+      d->magazine_size = MAGAZINE_BYTES / block_size;
+      if (d->magazine_size > MAGAZINE_MAX)
+        d->magazine_size = MAGAZINE_MAX;
+      if (d->magazine_size < 1)
+        d->magazine_size = 1;
+      d->batch_size = DIV_ROUND_UP (d->magazine_size, 2);
+      list_init (&d->arena_list);
       lock_init (&d->lock);
+      snprintf (name, sizeof name, "malloc %zu", block_size);
+      lock_profile (&d->lock, &d->profile, name);
     }
 }
 
@@ -92,6 +124,7 @@ malloc (size_t size)
   struct desc *d;
   struct block *b;
   struct arena *a;
+  struct magazine *mag;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -119,37 +152,14 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
-    {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
-    }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  /* Take a block from the running thread's magazine, refilling
+     it first if it is empty. */
+  mag = &thread_current ()->magazines[d - descs];
+  if (mag->cnt == 0 && !magazine_refill (d, mag))
+    return NULL;
+  b = mag->head;
+  mag->head = b->next;
+  mag->cnt--;
   return b;
 }
 
@@ -223,6 +233,7 @@ free (void *p)
       struct block *b = p;
       struct arena *a = block_to_arena (b);
       struct desc *d = a->desc;
+      struct magazine *mag;
       
       if (d != NULL) 
         {
@@ -233,26 +244,14 @@ free (void *p)
           memset (b, 0xcc, d->block_size);
 #endif
   
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
-
-          lock_release (&d->lock);
+          /* Put the block in the running thread's magazine,
+             making room first if it is full. */
+          mag = &thread_current ()->magazines[d - descs];
+          if (mag->cnt >= d->magazine_size)
+            magazine_flush (d, mag, d->batch_size);
+          b->next = mag->head;
+          mag->head = b;
+          mag->cnt++;
         }
       else
         {
@@ -263,6 +262,110 @@ free (void *p)
     }
 }
 
+/* Returns every block cached in the running thread's magazines
+   to its arena.  Must be called by a thread before it exits. */
+void
+malloc_flush_magazines (void) 
+{
+  struct thread *t = thread_current ();
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    if (t->magazines[i].cnt > 0)
+      magazine_flush (&descs[i], &t->magazines[i], t->magazines[i].cnt);
+}
+
+/* Moves up to D's batch size of blocks from D's arenas into MAG,
+   which must be empty, creating a new arena if necessary.
+   Returns true if at least one block was moved, false if memory
+   is not available. */
+static bool
+magazine_refill (struct desc *d, struct magazine *mag) 
+{
+  size_t i;
+
+  ASSERT (mag->cnt == 0);
+
+  lock_acquire (&d->lock);
+  for (i = 0; i < d->batch_size; i++) 
+    {
+      struct arena *a;
+      struct block *b;
+
+      /* If no arena has free blocks, create a new one. */
+      if (list_empty (&d->arena_list))
+        {
+          size_t j;
+
+          /* Allocate a page.  Settle for what we already have
+             if that fails. */
+          a = palloc_get_page (0);
+          if (a == NULL) 
+            break;
+
+          /* Initialize arena and put its blocks on its free list. */
+          a->magic = ARENA_MAGIC;
+          a->desc = d;
+          a->free_cnt = d->blocks_per_arena;
+          a->free_list = NULL;
+          for (j = d->blocks_per_arena; j-- > 0; ) 
+            {
+              b = arena_to_block (a, j);
+              b->next = a->free_list;
+              a->free_list = b;
+            }
+          list_push_front (&d->arena_list, &a->elem);
+        }
+
+      /* Move a block from the first arena into the magazine. */
+      a = list_entry (list_front (&d->arena_list), struct arena, elem);
+      b = a->free_list;
+      a->free_list = b->next;
+      if (--a->free_cnt == 0)
+        list_remove (&a->elem);
+      b->next = mag->head;
+      mag->head = b;
+      mag->cnt++;
+    }
+  lock_release (&d->lock);
+
+  return mag->cnt > 0;
+}
+
+/* Moves CNT blocks from MAG back to their arenas in D, freeing
+   any arena that thereby becomes entirely unused. */
+static void
+magazine_flush (struct desc *d, struct magazine *mag, size_t cnt) 
+{
+  ASSERT (cnt <= mag->cnt);
+
+  lock_acquire (&d->lock);
+  for (; cnt > 0; cnt--) 
+    {
+      struct block *b = mag->head;
+      struct arena *a = block_to_arena (b);
+
+      mag->head = b->next;
+      mag->cnt--;
+
+      /* Add block to its arena's free list.  An arena that had no
+         free blocks goes back on the descriptor's list. */
+      b->next = a->free_list;
+      a->free_list = b;
+      if (a->free_cnt++ == 0)
+        list_push_front (&d->arena_list, &a->elem);
+
+      /* If the arena is now entirely unused, free it. */
+      if (a->free_cnt >= d->blocks_per_arena) 
+        {
+          ASSERT (a->free_cnt == d->blocks_per_arena);
+          list_remove (&a->elem);
+          palloc_free_page (a);
+        }
+    }
+  lock_release (&d->lock);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
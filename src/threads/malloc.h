@@ -4,7 +4,19 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Maximum number of malloc() size classes. */
+#define MALLOC_DESC_MAX 10
+
+/* A per-thread cache of free blocks of one size class, linked
+   through their first words.  See malloc.c for details. */
+struct magazine
+  {
+    void *head;                 /* First free block. */
+    unsigned cnt;               /* Number of blocks cached. */
+  };
+
 void malloc_init (void);
+void malloc_flush_magazines (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
@@ -2,14 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -26,12 +27,66 @@
    half to the user pool.  That should be huge overkill for the
    kernel pool, but that's just fine for demonstration purposes. */
 
-/* A memory pool. */
+/* Number of block sizes managed by the buddy allocator.  The
+   largest block is 2**(BUDDY_ORDERS - 1) pages. */
+#define BUDDY_ORDERS 16
+
+/* A pool keeps at most 1/ZEROED_FRACTION of its pages, and no
+   more than ZEROED_MAX pages, pre-zeroed. */
+#define ZEROED_FRACTION 16
+#define ZEROED_MAX 256
+
+/* A memory pool.
+
+   Free memory in a pool is managed with a binary buddy
+   allocator.  Every free page belongs to exactly one free
+   "block" of 2**ORDER pages whose first page index is a multiple
+   of 2**ORDER, and each block is on the free list for its order.
+   The free list element lives in the block's first page, which
+   is otherwise unused.
+
+   An allocation of N pages takes the first block from the
+   smallest nonempty free list of order at least ceil(log2(N)),
+   splitting it in halves as needed, and then gives back any
+   pages beyond the first N.  Freeing pages returns them as
+   aligned blocks, each of which is merged with its "buddy" (the
+   other half of the block it was split from) for as long as the
+   buddy is also free.  Both operations take O(log n) time in
+   the size of the pool.
+
+   The free lists are short, bounded-time critical sections, so
+   they are protected by disabling interrupts rather than by a
+   lock.  That also lets pages be freed with interrupts off, as
+   happens when a dying thread's page is freed by
+   thread_schedule_tail().
+
+   Each pool also keeps a list of single pages that the idle
+   thread has already filled with zeros, so that PAL_ZERO
+   requests, such as every user frame, need not clear a page on
+   the page fault path.  Pre-zeroed pages are allocated from the
+   buddy allocator and marked used.  Their list element occupies
+   their first bytes, which are cleared when the page is handed
+   out.  If an allocation fails, the pre-zeroed pages are given
+   back to the buddy allocator and the allocation is retried. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    const char *name;                   /* Name, for statistics. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *free_order;                /* 1 + order of the free block
+                                           starting at each page, or 0. */
+    struct list free_lists[BUDDY_ORDERS]; /* Free blocks by order. */
     uint8_t *base;                      /* Base of pool. */
+    struct list zeroed_list;            /* Pre-zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pre-zeroed pages. */
+    size_t zeroed_max;                  /* Most pre-zeroed pages to keep. */
+
+    /* Statistics. */
+    size_t free_cnt;                    /* Number of free pages. */
+    long long split_cnt;                /* Number of blocks split. */
+    long long merge_cnt;                /* Number of buddies merged. */
+    long long fail_cnt;                 /* Number of failed allocations. */
+    long long zero_hit_cnt;             /* PAL_ZERO pages pre-zeroed. */
+    long long zero_miss_cnt;            /* PAL_ZERO pages zeroed inline. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -43,6 +98,11 @@ size_t user_page_limit = SIZE_MAX;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void print_pool_stats (struct pool *);
+static bool zero_free_page (struct pool *);
+static void release_zeroed_pages (struct pool *);
 
 /* Initializes the page allocator. */
 void
@@ -78,24 +138,48 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
+  enum intr_level old_level;
+  void *pages = NULL;
   size_t page_idx;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  old_level = intr_disable ();
+  if ((flags & PAL_ZERO) && page_cnt == 1 && pool->zeroed_cnt > 0) 
+    {
+      /* Hand out a page that is already zeroed. */
+      pages = list_pop_front (&pool->zeroed_list);
+      pool->zeroed_cnt--;
+      pool->zero_hit_cnt++;
+      zeroed = true;
+    }
+  else 
+    {
+      page_idx = buddy_alloc (pool, page_cnt);
+      if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) 
+        {
+          release_zeroed_pages (pool);
+          page_idx = buddy_alloc (pool, page_cnt);
+        }
+      if (page_idx != BITMAP_ERROR) 
+        {
+          bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+          pages = pool->base + PGSIZE * page_idx;
+          if (flags & PAL_ZERO)
+            pool->zero_miss_cnt += page_cnt;
+        }
+      else
+        pool->fail_cnt++;
+    }
+  intr_set_level (old_level);
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if (zeroed)
+        memset (pages, 0, sizeof (struct list_elem));
+      else if (flags & PAL_ZERO)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -125,6 +209,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -144,8 +229,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  buddy_free (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -155,15 +243,37 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one free page ahead of time for later PAL_ZERO
+   requests, if either pool is short of pre-zeroed pages.
+   Returns true if a page was zeroed, false if there was nothing
+   to do.  Meant to be called by the idle thread, with interrupts
+   on, since zeroing a page takes a while. */
+bool
+palloc_zero_idle (void) 
+{
+  return zero_free_page (&user_pool) || zero_free_page (&kernel_pool);
+}
+
+/* Prints statistics for both pools. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and free_order array at its
+     base.  Calculate the space needed for them and subtract it
+     from the pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -171,9 +281,25 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->name = name;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->free_order = (uint8_t *) base + bm_size;
+  memset (p->free_order, 0, page_cnt);
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    list_init (&p->free_lists[order]);
   p->base = base + bm_pages * PGSIZE;
+  list_init (&p->zeroed_list);
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt / ZEROED_FRACTION;
+  if (p->zeroed_max > ZEROED_MAX)
+    p->zeroed_max = ZEROED_MAX;
+  p->free_cnt = 0;
+  p->split_cnt = p->merge_cnt = p->fail_cnt = 0;
+  p->zero_hit_cnt = p->zero_miss_cnt = 0;
+
+  /* Every page starts out free. */
+  buddy_free (p, 0, page_cnt);
+  p->merge_cnt = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -187,3 +313,230 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free list element stored in page PAGE_IDX of P. */
+static struct list_elem *
+page_elem (struct pool *p, size_t page_idx) 
+{
+  return (struct list_elem *) (p->base + PGSIZE * page_idx);
+}
+
+/* Returns the index of the page in P that contains E. */
+static size_t
+elem_page (struct pool *p, struct list_elem *e) 
+{
+  return pg_no (e) - pg_no (p->base);
+}
+
+/* Returns the smallest ORDER such that 2**ORDER >= PAGE_CNT. */
+static int
+page_cnt_to_order (size_t page_cnt) 
+{
+  int order = 0;
+
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to P's free
+   lists, without merging it with its buddy. */
+static void
+push_block (struct pool *p, size_t page_idx, int order) 
+{
+  p->free_order[page_idx] = order + 1;
+  list_push_front (&p->free_lists[order], page_elem (p, page_idx));
+  p->free_cnt += (size_t) 1 << order;
+}
+
+/* Removes the free block of 2**ORDER pages at PAGE_IDX from P's
+   free lists. */
+static void
+remove_block (struct pool *p, size_t page_idx, int order) 
+{
+  ASSERT (p->free_order[page_idx] == order + 1);
+  p->free_order[page_idx] = 0;
+  list_remove (page_elem (p, page_idx));
+  p->free_cnt -= (size_t) 1 << order;
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in P, merging it
+   with its buddy for as long as the buddy is free too. */
+static void
+free_block (struct pool *p, size_t page_idx, int order) 
+{
+  while (order + 1 < BUDDY_ORDERS) 
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      if (buddy_idx >= bitmap_size (p->used_map)
+          || p->free_order[buddy_idx] != order + 1)
+        break;
+
+      remove_block (p, buddy_idx, order);
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+      p->merge_cnt++;
+    }
+  push_block (p, page_idx, order);
+}
+
+/* Allocates PAGE_CNT contiguous pages from P and returns the
+   index of the first one, or BITMAP_ERROR if no large enough
+   block is free.  Must be called with interrupts off. */
+static size_t
+buddy_alloc (struct pool *p, size_t page_cnt) 
+{
+  int want = page_cnt_to_order (page_cnt);
+  int order;
+  size_t page_idx;
+  size_t block_cnt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Find the smallest free block that is big enough. */
+  for (order = want; order < BUDDY_ORDERS; order++)
+    if (!list_empty (&p->free_lists[order]))
+      break;
+  if (order >= BUDDY_ORDERS)
+    return BITMAP_ERROR;
+
+  page_idx = elem_page (p, list_front (&p->free_lists[order]));
+  remove_block (p, page_idx, order);
+
+  /* Split it down to the size we want, freeing the upper
+     halves. */
+  while (order > want) 
+    {
+      order--;
+      push_block (p, page_idx + ((size_t) 1 << order), order);
+      p->split_cnt++;
+    }
+
+  /* Give back the pages past PAGE_CNT. */
+  block_cnt = (size_t) 1 << want;
+  if (block_cnt > page_cnt)
+    buddy_free (p, page_idx + page_cnt, block_cnt - page_cnt);
+
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in P, as a
+   sequence of the largest aligned blocks that fit.  Must be
+   called with interrupts off. */
+static void
+buddy_free (struct pool *p, size_t page_idx, size_t page_cnt) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+
+      while (order + 1 < BUDDY_ORDERS
+             && page_idx % ((size_t) 1 << (order + 1)) == 0
+             && ((size_t) 1 << (order + 1)) <= page_cnt)
+        order++;
+
+      free_block (p, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Prints statistics for pool P.  Fragmentation is the share of
+   free pages that lie outside the largest free block: 0% means
+   all free memory is one block. */
+static void
+print_pool_stats (struct pool *p) 
+{
+  enum intr_level old_level;
+  size_t block_cnt[BUDDY_ORDERS];
+  size_t free_cnt, largest = 0;
+  long long split_cnt, merge_cnt, fail_cnt, zero_hit_cnt, zero_miss_cnt;
+  size_t zeroed_cnt;
+  int order;
+
+  old_level = intr_disable ();
+  for (order = 0; order < BUDDY_ORDERS; order++) 
+    {
+      block_cnt[order] = list_size (&p->free_lists[order]);
+      if (block_cnt[order] > 0)
+        largest = (size_t) 1 << order;
+    }
+  free_cnt = p->free_cnt;
+  split_cnt = p->split_cnt;
+  merge_cnt = p->merge_cnt;
+  fail_cnt = p->fail_cnt;
+  zeroed_cnt = p->zeroed_cnt;
+  zero_hit_cnt = p->zero_hit_cnt;
+  zero_miss_cnt = p->zero_miss_cnt;
+  intr_set_level (old_level);
+
+  printf ("Palloc %s: %zu of %zu pages free, largest free block %zu pages, "
+          "%zu%% fragmented\n",
+          p->name, free_cnt, bitmap_size (p->used_map), largest,
+          free_cnt > 0 ? 100 - largest * 100 / free_cnt : 0);
+  printf ("  %lld splits, %lld merges, %lld failed allocations; "
+          "free blocks by order:",
+          split_cnt, merge_cnt, fail_cnt);
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    if (block_cnt[order] > 0)
+      printf (" %d:%zu", order, block_cnt[order]);
+  printf ("\n");
+  printf ("  %zu pages pre-zeroed; %lld PAL_ZERO pages pre-zeroed, "
+          "%lld zeroed inline\n",
+          zeroed_cnt, zero_hit_cnt, zero_miss_cnt);
+}
+
+/* If P has fewer pre-zeroed pages than it wants, takes a free
+   page from P, zeroes it with interrupts on, and adds it to P's
+   pre-zeroed list.  Returns true if successful, false if P has
+   enough pre-zeroed pages or no free page. */
+static bool
+zero_free_page (struct pool *p) 
+{
+  enum intr_level old_level;
+  size_t page_idx;
+  void *page;
+
+  old_level = intr_disable ();
+  if (p->zeroed_cnt >= p->zeroed_max) 
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  page_idx = buddy_alloc (p, 1);
+  if (page_idx == BITMAP_ERROR) 
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  bitmap_mark (p->used_map, page_idx);
+  intr_set_level (old_level);
+
+  page = p->base + PGSIZE * page_idx;
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  list_push_back (&p->zeroed_list, page);
+  p->zeroed_cnt++;
+  intr_set_level (old_level);
+
+  return true;
+}
+
+/* Gives all of P's pre-zeroed pages back to the buddy
+   allocator.  Must be called with interrupts off. */
+static void
+release_zeroed_pages (struct pool *p) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&p->zeroed_list)) 
+    {
+      size_t page_idx = elem_page (p, list_pop_front (&p->zeroed_list));
+      bitmap_reset (p->used_map, page_idx);
+      buddy_free (p, page_idx, 1);
+    }
+  p->zeroed_cnt = 0;
+}
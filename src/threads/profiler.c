@@ -0,0 +1,69 @@
+#include "threads/profiler.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "userprog/gdt.h"
+
+/* Samples per second, or 0 if the profiler is off.  Set by kernel
+   command-line option "-prof". */
+int profiler_hz;
+
+/* Ring buffer of samples.  Sample number N is in
+   ring[N % PROFILER_CNT]. */
+static struct profiler_sample ring[PROFILER_CNT];
+
+/* Number of samples taken so far. */
+static uint32_t sample_cnt;
+
+/* Turns on the profiler at HZ samples per second, which is
+   rounded down to a multiple of TIMER_FREQ between TIMER_FREQ and
+   PROFILER_MAX_HZ.  Must be called before timer_init(). */
+void
+profiler_enable (int hz)
+{
+  if (hz > PROFILER_MAX_HZ)
+    hz = PROFILER_MAX_HZ;
+  hz -= hz % TIMER_FREQ;
+  profiler_hz = hz > TIMER_FREQ ? hz : TIMER_FREQ;
+}
+
+/* Records a sample of the code interrupted by timer interrupt
+   frame F. */
+void
+profiler_sample (const struct intr_frame *f)
+{
+  struct profiler_sample *s;
+
+  ASSERT (intr_context ());
+
+  s = &ring[sample_cnt++ % PROFILER_CNT];
+  s->eip = (uint32_t) f->eip;
+  s->tid = thread_tid ();
+  s->user = f->cs == SEL_UCSEG;
+}
+
+/* Copies up to MAX_CNT of the most recent samples into SAMPLES,
+   oldest first, and returns the number copied.  Stores the total
+   number of samples taken, including those overwritten, into
+   *INTERRUPT_CNTP. */
+size_t
+profiler_read (struct profiler_sample *samples, size_t max_cnt,
+               uint32_t *interrupt_cntp)
+{
+  enum intr_level old_level;
+  uint32_t first;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = sample_cnt < PROFILER_CNT ? sample_cnt : PROFILER_CNT;
+  if (cnt > max_cnt)
+    cnt = max_cnt;
+  first = sample_cnt - cnt;
+  for (i = 0; i < cnt; i++)
+    samples[i] = ring[(first + i) % PROFILER_CNT];
+  *interrupt_cntp = sample_cnt;
+  intr_set_level (old_level);
+
+  return cnt;
+}
@@ -0,0 +1,51 @@
+#ifndef THREADS_PROFILER_H
+#define THREADS_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Statistical profiler.
+
+   When enabled by kernel option "-prof[=HZ]", every timer
+   interrupt records the interrupted instruction pointer and
+   thread in a ring buffer of samples, overwriting the oldest once
+   it fills.  With HZ above TIMER_FREQ, the timer interrupts HZ
+   times per second, while timer ticks still advance TIMER_FREQ
+   times per second.  The "profile FILE" action saves the buffer
+   into the file system, and src/utils/pintos-prof symbolizes it
+   with backtrace. */
+
+/* Number of samples kept.  Must be a power of 2. */
+#define PROFILER_CNT 8192
+
+/* Highest sampling rate accepted. */
+#define PROFILER_MAX_HZ 10000
+
+/* One sample, as stored in the buffer and in saved profiles. */
+struct profiler_sample
+  {
+    uint32_t eip;               /* Interrupted instruction. */
+    uint16_t tid;               /* Interrupted thread. */
+    uint16_t user;              /* 1 if EIP is in user code, else 0. */
+  };
+
+/* Header at the start of a saved profile, followed by SAMPLE_CNT
+   samples from oldest to newest. */
+struct profiler_header
+  {
+    char magic[4];              /* "PRF\0". */
+    uint32_t sample_cnt;        /* Number of samples that follow. */
+    uint32_t interrupt_cnt;     /* Samples taken, including overwritten. */
+    uint32_t hz;                /* Samples per second. */
+  };
+
+struct intr_frame;
+
+extern int profiler_hz;
+
+void profiler_enable (int hz);
+void profiler_sample (const struct intr_frame *);
+size_t profiler_read (struct profiler_sample *, size_t max_cnt,
+                      uint32_t *interrupt_cnt);
+
+#endif /* threads/profiler.h */
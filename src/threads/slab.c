@@ -0,0 +1,289 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for fixed-size kernel objects.
+
+   Each cache hands out objects of a single size.  Objects live
+   in "slabs", single pages obtained from the page allocator,
+   that start with a `struct slab' header followed by as many
+   objects as fit.  A slab keeps its free objects on a singly
+   linked list threaded through the objects themselves.
+
+   A cache keeps its slabs on three lists: partially used, fully
+   used, and entirely free.  Allocation takes an object from a
+   partial slab, falling back to a free slab and then to a new
+   page.  Freeing an object finds its slab by rounding the
+   object's address down to a page boundary, so no lookup is
+   needed.  At most one entirely free slab is kept around per
+   cache; any more are returned to the page allocator.
+
+   If a cache has a constructor, it is run on every object of a
+   slab when the slab is created, not on every allocation.
+   Objects must therefore be returned to such a cache in their
+   constructed state.  Because the free-list link would clobber
+   constructed state, such caches keep the link in an extra word
+   just past each object instead of in the object itself.
+
+   Unlike malloc(), every cache has a lock of its own, so unrelated
+   object types never contend with each other. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A cache of objects of one size. */
+struct slab_cache 
+  {
+    struct list_elem elem;      /* Element in list of all caches. */
+    struct lock lock;           /* Protects the members below. */
+    struct lock_profile profile; /* Contention statistics for LOCK. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t link_ofs;            /* Offset of free-list link in object. */
+    size_t stride;              /* Distance between objects in a slab. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    void (*ctor) (void *);      /* Constructor, or null. */
+
+    struct list partial_slabs;  /* Slabs with some objects in use. */
+    struct list full_slabs;     /* Slabs with every object in use. */
+    struct list free_slabs;     /* Slabs with no object in use. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Number of slabs. */
+    size_t in_use_cnt;          /* Number of objects in use. */
+    long long alloc_cnt;        /* Number of allocations. */
+    long long free_cnt;         /* Number of frees. */
+  };
+
+/* Slab header, at the start of each slab's page. */
+struct slab 
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of the cache's lists. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free_list;            /* First free object. */
+  };
+
+/* List of all caches, for statistics. */
+static struct list all_caches;
+
+static struct slab *slab_create (struct slab_cache *);
+static struct slab *obj_to_slab (void *);
+
+/* Returns the free-list link of OBJ in cache C. */
+static inline void **
+free_link (struct slab_cache *c, void *obj) 
+{
+  return (void **) ((uint8_t *) obj + c->link_ofs);
+}
+
+/* Initializes the slab allocator. */
+void
+slab_init (void) 
+{
+  list_init (&all_caches);
+}
+
+/* Creates and returns a cache named NAME of SIZE-byte objects,
+   or a null pointer if memory is not available.  If CTOR is
+   non-null, it is called on each object when the object is
+   first created. */
+struct slab_cache *
+slab_cache_create (const char *name, size_t size, void (*ctor) (void *)) 
+{
+  struct slab_cache *c;
+
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  /* Objects may hold the free-list link while they are free, and
+     stay word-aligned. */
+  if (size < sizeof (void *))
+    size = sizeof (void *);
+  c->obj_size = ROUND_UP (size, sizeof (void *));
+  c->link_ofs = ctor != NULL ? c->obj_size : 0;
+  c->stride = ctor != NULL ? c->obj_size + sizeof (void *) : c->obj_size;
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / c->stride;
+  ASSERT (c->objs_per_slab > 0);
+  c->ctor = ctor;
+
+  lock_init (&c->lock);
+  lock_profile (&c->lock, &c->profile, name);
+  list_init (&c->partial_slabs);
+  list_init (&c->full_slabs);
+  list_init (&c->free_slabs);
+  c->slab_cnt = 0;
+  c->in_use_cnt = 0;
+  c->alloc_cnt = 0;
+  c->free_cnt = 0;
+  list_push_back (&all_caches, &c->elem);
+  return c;
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c) 
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->partial_slabs))
+    s = list_entry (list_front (&c->partial_slabs), struct slab, elem);
+  else if (!list_empty (&c->free_slabs)) 
+    {
+      s = list_entry (list_pop_front (&c->free_slabs), struct slab, elem);
+      list_push_front (&c->partial_slabs, &s->elem);
+    }
+  else 
+    {
+      s = slab_create (c);
+      if (s == NULL) 
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial_slabs, &s->elem);
+    }
+
+  /* Take the first free object. */
+  obj = s->free_list;
+  s->free_list = *free_link (c, obj);
+  if (--s->free_cnt == 0) 
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full_slabs, &s->elem);
+    }
+  c->in_use_cnt++;
+  c->alloc_cnt++;
+  lock_release (&c->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C with
+   slab_alloc(), to C.  A null OBJ is ignored. */
+void
+slab_free (struct slab_cache *c, void *obj) 
+{
+  struct slab *s;
+
+  ASSERT (c != NULL);
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (obj);
+  ASSERT (s->cache == c);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     the cache expects it back in constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  *free_link (c, obj) = s->free_list;
+  s->free_list = obj;
+  if (s->free_cnt++ == 0) 
+    {
+      /* Was full, now partial. */
+      list_remove (&s->elem);
+      list_push_front (&c->partial_slabs, &s->elem);
+    }
+  if (s->free_cnt == c->objs_per_slab) 
+    {
+      /* Entirely free.  Keep one such slab cached and give the
+         rest back to the page allocator. */
+      list_remove (&s->elem);
+      if (list_empty (&c->free_slabs))
+        list_push_front (&c->free_slabs, &s->elem);
+      else 
+        {
+          c->slab_cnt--;
+          palloc_free_page (s);
+        }
+    }
+  c->in_use_cnt--;
+  c->free_cnt++;
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for every cache. */
+void
+slab_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e)) 
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      printf ("Slab %s: %zu-byte objects, %zu in use, %zu slabs, "
+              "%lld allocs, %lld frees\n",
+              c->profile.stat.name, c->obj_size, c->in_use_cnt,
+              c->slab_cnt, c->alloc_cnt, c->free_cnt);
+    }
+}
+
+/* Allocates a new slab for cache C, threads its objects onto
+   its free list and runs C's constructor on each of them.
+   Returns a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct slab_cache *c) 
+{
+  struct slab *s;
+  uint8_t *obj;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  s->free_list = NULL;
+
+  /* Build the free list back to front so that objects are handed
+     out in address order. */
+  obj = (uint8_t *) (s + 1) + c->stride * c->objs_per_slab;
+  for (i = 0; i < c->objs_per_slab; i++) 
+    {
+      obj -= c->stride;
+      if (c->ctor != NULL)
+        c->ctor (obj);
+      *free_link (c, obj) = s->free_list;
+      s->free_list = obj;
+    }
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab that object OBJ is inside. */
+static struct slab *
+obj_to_slab (void *obj) 
+{
+  struct slab *s = pg_round_down (obj);
+
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT ((uint8_t *) obj >= (uint8_t *) (s + 1));
+  ASSERT (((uint8_t *) obj - (uint8_t *) (s + 1)) % s->cache->stride == 0);
+
+  return s;
+}
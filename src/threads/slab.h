@@ -0,0 +1,17 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* An object cache that hands out fixed-size objects of a single
+   type.  See slab.c for details. */
+struct slab_cache;
+
+void slab_init (void);
+struct slab_cache *slab_cache_create (const char *name, size_t size,
+                                      void (*ctor) (void *));
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
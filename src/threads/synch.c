@@ -27,10 +27,24 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* If true, lock_acquire() and friends keep statistics for
+   locks registered with lock_profile().  Controlled by kernel
+   command-line option "-lockprof". */
+bool lock_profiling;
+
+/* List of profiled locks' `struct lock_profile's. */
+static struct list profiled_locks;
+
+static bool profile_begin (struct lock *, int64_t *start);
+static void profile_acquired (struct lock *, bool contended, int64_t start);
+static void profile_released (struct lock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -179,6 +193,7 @@ lock_init (struct lock *lock)
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
+  lock->profile = NULL;
   sema_init (&lock->semaphore, 1);
 }
 
@@ -193,12 +208,17 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  int64_t start;
+  bool contended;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  contended = profile_begin (lock, &start);
   sema_down (&lock->semaphore);
   lock->holder = thread_current ();
+  profile_acquired (lock, contended, start);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -217,7 +237,10 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      profile_acquired (lock, false, 0);
+    }
   return success;
 }
 
@@ -233,6 +256,7 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  profile_released (lock);
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -247,6 +271,436 @@ lock_held_by_current_thread (const struct lock *lock)
 
   return lock->holder == thread_current ();
 }
+
+/* Number of times mutex_acquire() polls a mutex whose holder is
+   still running before it gives up and blocks. */
+#define MUTEX_SPIN_LIMIT 64
+
+static bool mutex_grab (struct mutex *);
+static bool mutex_spin (struct mutex *);
+
+/* Initializes mutex M.  A mutex has the same ownership rules as
+   a lock: it is held by at most one thread at a time and must be
+   released by the thread that acquired it. */
+void
+mutex_init (struct mutex *m)
+{
+  ASSERT (m != NULL);
+
+  lock_init (&m->lock);
+}
+
+/* Acquires mutex M.  If M is held by a thread that is running
+   on another CPU, spins briefly in the hope that it is released
+   soon; otherwise, or if spinning does not pay off, donates the
+   current thread's priority to the holder and sleeps until M
+   becomes available.  The mutex must not already be held by the
+   current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+mutex_acquire (struct mutex *m)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t start;
+  bool contended;
+
+  ASSERT (m != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!mutex_held_by_current_thread (m));
+
+  contended = profile_begin (&m->lock, &start);
+  if (mutex_spin (m))
+    {
+      profile_acquired (&m->lock, contended, start);
+      return;
+    }
+
+  old_level = intr_disable ();
+  if (m->lock.holder != NULL)
+    {
+      cur->desire_lock = &m->lock;
+      thread_donate_priority (m->lock.holder, &m->lock, cur->priority);
+    }
+  sema_down (&m->lock.semaphore);
+  cur->desire_lock = NULL;
+  m->lock.holder = cur;
+  list_push_back (&cur->holding_lock_list, &m->lock.elem);
+  intr_set_level (old_level);
+  profile_acquired (&m->lock, contended, start);
+}
+
+/* Tries to acquire mutex M without spinning or sleeping and
+   returns true if successful or false on failure.  The mutex
+   must not already be held by the current thread. */
+bool
+mutex_try_acquire (struct mutex *m)
+{
+  ASSERT (m != NULL);
+  ASSERT (!mutex_held_by_current_thread (m));
+
+  if (!mutex_grab (m))
+    return false;
+  profile_acquired (&m->lock, false, 0);
+  return true;
+}
+
+/* Releases mutex M, which must be owned by the current thread.
+   Any priority that was donated to the current thread through M
+   is given up, and if that drops the current thread's priority
+   it yields so that the donor can run. */
+void
+mutex_release (struct mutex *m)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int old_priority;
+
+  ASSERT (m != NULL);
+  ASSERT (mutex_held_by_current_thread (m));
+
+  profile_released (&m->lock);
+  old_level = intr_disable ();
+  old_priority = cur->priority;
+  list_remove (&m->lock.elem);
+  m->lock.holder = NULL;
+  thread_restore_priority (&m->lock);
+  sema_up (&m->lock.semaphore);
+  intr_set_level (old_level);
+
+  if (old_level == INTR_ON && cur->priority < old_priority)
+    thread_yield ();
+}
+
+/* Returns true if the current thread holds mutex M, false
+   otherwise. */
+bool
+mutex_held_by_current_thread (const struct mutex *m)
+{
+  ASSERT (m != NULL);
+
+  return lock_held_by_current_thread (&m->lock);
+}
+
+/* Takes mutex M if it is free and returns true, or returns
+   false without waiting if it is held. */
+static bool
+mutex_grab (struct mutex *m)
+{
+  enum intr_level old_level;
+  bool success;
+
+  old_level = intr_disable ();
+  success = sema_try_down (&m->lock.semaphore);
+  if (success)
+    {
+      m->lock.holder = thread_current ();
+      list_push_back (&m->lock.holder->holding_lock_list, &m->lock.elem);
+    }
+  intr_set_level (old_level);
+  return success;
+}
+
+/* Spins on mutex M while its holder is running, for at most
+   MUTEX_SPIN_LIMIT rounds.  Returns true if M was acquired,
+   false if the caller should block instead.  On a uniprocessor
+   the holder is never running while we are, so this gives up
+   after a single attempt. */
+static bool
+mutex_spin (struct mutex *m)
+{
+  int spins;
+
+  if (intr_get_level () == INTR_OFF)
+    return mutex_grab (m);
+
+  for (spins = 0; spins < MUTEX_SPIN_LIMIT; spins++)
+    {
+      struct thread *holder;
+
+      if (mutex_grab (m))
+        return true;
+
+      holder = m->lock.holder;
+      if (holder != NULL && holder->status != THREAD_RUNNING)
+        break;
+      asm volatile ("pause" : : : "memory");
+    }
+  return false;
+}
+
+/* Wakes up the highest-priority thread waiting to write RW.
+   Priorities may have changed through donation since the waiters
+   were queued, so the list is sorted again first.  Interrupts
+   must be off. */
+static void
+rwlock_wake_writer (struct rwlock *rw)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_sort (&rw->write_waiters, priority_bigger, NULL);
+  thread_unblock (list_entry (list_pop_front (&rw->write_waiters),
+                              struct thread, elem));
+}
+
+/* Initializes reader-writer lock RW. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  rw->readers = 0;
+  rw->waiting_writers = 0;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.  While sleeping behind a writer, donates
+   the current thread's priority to that writer.
+
+   Readers are not tracked individually, so a writer that waits
+   for readers to drain cannot donate to them; writer preference
+   bounds that wait to the readers already inside.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  while (rw->lock.holder != NULL || rw->waiting_writers > 0)
+    {
+      if (rw->lock.holder != NULL)
+        {
+          cur->desire_lock = &rw->lock;
+          thread_donate_priority (rw->lock.holder, &rw->lock, cur->priority);
+        }
+      list_insert_ordered (&rw->read_waiters, &cur->elem,
+                           priority_bigger, NULL);
+      thread_block ();
+    }
+  cur->desire_lock = NULL;
+  rw->readers++;
+  intr_set_level (old_level);
+}
+
+/* Releases read access to RW.  The last reader out wakes up a
+   waiting writer, if any. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && !list_empty (&rw->write_waiters))
+    rwlock_wake_writer (rw);
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no reader or writer
+   holds it.  While another writer holds RW, donates the current
+   thread's priority to it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->waiting_writers++;
+  while (rw->lock.holder != NULL || rw->readers > 0)
+    {
+      if (rw->lock.holder != NULL)
+        {
+          cur->desire_lock = &rw->lock;
+          thread_donate_priority (rw->lock.holder, &rw->lock, cur->priority);
+        }
+      list_insert_ordered (&rw->write_waiters, &cur->elem,
+                           priority_bigger, NULL);
+      thread_block ();
+    }
+  rw->waiting_writers--;
+  cur->desire_lock = NULL;
+  rw->lock.holder = cur;
+  list_push_back (&cur->holding_lock_list, &rw->lock.elem);
+  intr_set_level (old_level);
+}
+
+/* Releases write access to RW, which must be held by the current
+   thread.  Hands RW to the next waiting writer if there is one,
+   otherwise wakes every waiting reader.  Gives up any priority
+   donated through RW. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int old_priority;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  old_priority = cur->priority;
+  list_remove (&rw->lock.elem);
+  rw->lock.holder = NULL;
+  thread_restore_priority (&rw->lock);
+  if (!list_empty (&rw->write_waiters))
+    rwlock_wake_writer (rw);
+  else
+    while (!list_empty (&rw->read_waiters))
+      thread_unblock (list_entry (list_pop_front (&rw->read_waiters),
+                                  struct thread, elem));
+  intr_set_level (old_level);
+
+  if (old_level == INTR_ON && cur->priority < old_priority)
+    thread_yield ();
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise.  Read access is not tracked per thread. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->lock);
+}
+
+/* Initializes the list of profiled locks. */
+void
+lock_profile_init (void)
+{
+  list_init (&profiled_locks);
+}
+
+/* Registers LOCK for contention profiling under NAME, keeping
+   its statistics in PROFILE, which must stay valid for as long as
+   LOCK does.  Statistics are only gathered while lock_profiling
+   is true. */
+void
+lock_profile (struct lock *lock, struct lock_profile *profile,
+              const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (profile != NULL);
+  ASSERT (name != NULL);
+
+  memset (profile, 0, sizeof *profile);
+  strlcpy (profile->stat.name, name, sizeof profile->stat.name);
+
+  old_level = intr_disable ();
+  lock->profile = profile;
+  list_push_back (&profiled_locks, &profile->elem);
+  intr_set_level (old_level);
+}
+
+/* Copies the statistics of up to MAX_CNT profiled locks into
+   STATS and returns the number copied. */
+int
+lock_profile_read (struct lockstat *stats, int max_cnt)
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  int cnt = 0;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&profiled_locks);
+       e != list_end (&profiled_locks) && cnt < max_cnt; e = list_next (e))
+    stats[cnt++] = list_entry (e, struct lock_profile, elem)->stat;
+  intr_set_level (old_level);
+  return cnt;
+}
+
+/* Prints the statistics of every profiled lock. */
+void
+lock_print_stats (void)
+{
+  struct list_elem *e;
+
+  if (!lock_profiling)
+    return;
+
+  for (e = list_begin (&profiled_locks); e != list_end (&profiled_locks);
+       e = list_next (e))
+    {
+      struct lockstat *s = &list_entry (e, struct lock_profile, elem)->stat;
+      printf ("Lock %s: %"PRIu32" acquires, %"PRIu32" contended, "
+              "%"PRId64" wait ticks, %"PRId64" max hold ticks\n",
+              s->name, s->acquire_cnt, s->contended_cnt,
+              s->wait_ticks, s->max_hold_ticks);
+    }
+}
+
+/* Called before waiting for LOCK.  If LOCK is being profiled,
+   stores the current time in *START and returns true if LOCK is
+   currently held, that is, if the acquisition will contend. */
+static bool
+profile_begin (struct lock *lock, int64_t *start)
+{
+  *start = 0;
+  if (!lock_profiling || lock->profile == NULL)
+    return false;
+  *start = timer_ticks ();
+  return lock->semaphore.value == 0;
+}
+
+/* Records that the current thread acquired LOCK, having waited
+   since START if CONTENDED. */
+static void
+profile_acquired (struct lock *lock, bool contended, int64_t start)
+{
+  struct lock_profile *p = lock->profile;
+
+  if (!lock_profiling || p == NULL)
+    return;
+
+  p->acquired_at = timer_ticks ();
+  p->stat.acquire_cnt++;
+  if (contended)
+    {
+      p->stat.contended_cnt++;
+      p->stat.wait_ticks += p->acquired_at - start;
+    }
+}
+
+/* Records that the current thread is about to release LOCK. */
+static void
+profile_released (struct lock *lock)
+{
+  struct lock_profile *p = lock->profile;
+  int64_t held;
+
+  if (!lock_profiling || p == NULL)
+    return;
+
+  held = timer_ticks () - p->acquired_at;
+  if (held > p->stat.max_hold_ticks)
+    p->stat.max_hold_ticks = held;
+}
 
 /* One semaphore in a list. */
 
@@ -2,7 +2,9 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <lockstat.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
@@ -29,6 +31,8 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's holding_lock_list. */
+    struct lock_profile *profile; /* Contention statistics, or null. */
   };
 
 void lock_init (struct lock *);
@@ -37,6 +41,60 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Contention profile of a named lock.  Only gathered while
+   lock_profiling is true (kernel option "-lockprof"). */
+struct lock_profile 
+  {
+    struct lockstat stat;       /* Statistics gathered so far. */
+    int64_t acquired_at;        /* Tick of the current acquisition. */
+    struct list_elem elem;      /* Element in list of profiled locks. */
+  };
+
+extern bool lock_profiling;
+
+void lock_profile_init (void);
+void lock_profile (struct lock *, struct lock_profile *, const char *name);
+int lock_profile_read (struct lockstat *, int max_cnt);
+void lock_print_stats (void);
+
+/* Adaptive mutex.  Behaves like a lock, but a thread that finds
+   it held first spins for a short while as long as the holder is
+   running on another CPU, and only blocks once the holder is
+   descheduled or the spin budget runs out.  A blocked waiter
+   donates its priority to the holder. */
+struct mutex 
+  {
+    struct lock lock;           /* Underlying lock. */
+  };
+
+void mutex_init (struct mutex *);
+void mutex_acquire (struct mutex *);
+bool mutex_try_acquire (struct mutex *);
+void mutex_release (struct mutex *);
+bool mutex_held_by_current_thread (const struct mutex *);
+
+/* Reader-writer lock.  Any number of readers may hold it at
+   once, or a single writer.  Once a writer is waiting, new
+   readers queue behind it so that writers cannot starve.
+   Waiting writers are woken in priority order.  The embedded
+   lock's holder is the writer, if any, and serves as the target
+   of priority donation. */
+struct rwlock 
+  {
+    struct lock lock;           /* Writer and donation target. */
+    unsigned readers;           /* # of threads holding read access. */
+    unsigned waiting_writers;   /* # of threads waiting to write. */
+    struct list read_waiters;   /* Threads waiting to read. */
+    struct list write_waiters;  /* Threads waiting to write. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Condition variable. */
 struct condition 
   {
@@ -7,9 +7,11 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/fp.h"
 #include "devices/timer.h"
@@ -150,10 +152,11 @@ thread_start (void)
   sema_down (&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+/* Called by the timer interrupt handler at each timer tick,
+   with USER true if the tick interrupted user code.  Thus, this
+   function runs in an external interrupt context. */
 void
-thread_tick (void) 
+thread_tick (bool user) 
 {
   struct thread *t = thread_current ();
   struct list_elem *e;
@@ -188,6 +191,10 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+  if (user)
+    t->usage.user_ticks++;
+  else
+    t->usage.kernel_ticks++;
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
@@ -238,6 +245,7 @@ thread_create (const char *name, int priority,
   t->recent_cpu = thread_current()->recent_cpu;
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  trace_thread (tid, name);
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -339,6 +347,10 @@ thread_exit (void)
   process_exit ();
 #endif
 
+  /* Give blocks cached by this thread back to the allocator
+     before our page goes away. */
+  malloc_flush_magazines ();
+
   /* Just set our status to dying and schedule another process.
      We will be destroyed during the call to schedule_tail(). */
   intr_disable ();
@@ -389,6 +401,92 @@ thread_set_priority (int new_priority)
   }
 }
 
+/* Maximum depth of a chain of nested donations that
+   thread_donate_priority() follows. */
+#define DONATION_DEPTH 8
+
+/* Donates PRIORITY to T on behalf of LOCK, which T holds and
+   which the current thread is about to wait for.  The donation
+   is recorded in T's lock_stack so that it can be withdrawn when
+   T releases LOCK, and is passed on along T's desire_lock chain
+   so that nested holders are boosted too.  Does nothing under
+   the MLFQS scheduler.  Must be called with interrupts off. */
+void
+thread_donate_priority (struct thread *t, struct lock *lock, int priority)
+{
+  const int stack_max = sizeof t->lock_stack / sizeof *t->lock_stack;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  for (depth = 0; t != NULL && depth < DONATION_DEPTH; depth++)
+    {
+      int i;
+
+      for (i = 1; i < t->size; i++)
+        if (t->lock_stack[i] == lock)
+          break;
+      if (i < t->size)
+        {
+          if (t->priority_stack[i] < priority)
+            t->priority_stack[i] = priority;
+        }
+      else if (t->size < stack_max)
+        {
+          t->lock_stack[t->size] = lock;
+          t->priority_stack[t->size] = priority;
+          t->size++;
+        }
+
+      if (t->priority >= priority)
+        break;
+      t->priority = priority;
+      if (t->status == THREAD_READY)
+        {
+          list_remove (&t->elem);
+          list_insert_ordered (&ready_list, &t->elem, priority_bigger, NULL);
+        }
+
+      lock = t->desire_lock;
+      t = lock != NULL ? lock->holder : NULL;
+    }
+}
+
+/* Withdraws every donation the current thread received through
+   LOCK, which it is releasing, and recomputes its priority from
+   its base priority and the donations that remain.  Must be
+   called with interrupts off. */
+void
+thread_restore_priority (struct lock *lock)
+{
+  struct thread *curr = thread_current ();
+  int i, j;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  if (list_empty (&curr->holding_lock_list))
+    curr->size = 1;
+  for (i = j = 1; i < curr->size; i++)
+    if (curr->lock_stack[i] != lock)
+      {
+        curr->lock_stack[j] = curr->lock_stack[i];
+        curr->priority_stack[j] = curr->priority_stack[i];
+        j++;
+      }
+  curr->size = j;
+
+  curr->priority = curr->priority_stack[0];
+  for (i = 1; i < curr->size; i++)
+    if (curr->priority_stack[i] > curr->priority)
+      curr->priority = curr->priority_stack[i];
+}
+
 /* Returns the current thread's priority. */
 int
 thread_get_priority (void) 
@@ -452,6 +550,15 @@ idle (void *idle_started_ UNUSED)
 
   for (;;) 
     {
+      /* Spend spare time zeroing free pages for PAL_ZERO
+         requests, one page at a time, letting anyone who became
+         ready in the meantime run after each page. */
+      if (palloc_zero_idle ()) 
+        {
+          thread_yield ();
+          continue;
+        }
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
@@ -530,12 +637,17 @@ init_thread (struct thread *t, const char *name, int priority)
   else{
     t->priority = PRI_MAX - ftoi(fdiv((t->recent_cpu),itof(4))) - t->nice*2;
   }
+  list_init(&t->holding_lock_list);
   list_init(&t->mmap_list);
+  list_init(&t->vma_list);
+#ifdef USERPROG
+  /* A new process inherits its creator's open file limit. */
+  fd_table_init (&t->fds, running_thread ()->fds.limit);
+#endif
   list_init(&t->child_list);
   sema_init(&t->wait_lock,0);
   sema_init(&t->wait_memory,0);
   sema_init(&t->wait_free,0);
-  sema_init(&t->wait_load, 0);
   list_push_back(&running_thread()->child_list, &t->child_elem);
   list_push_back(&thread_list, &t->thread_elem);
   t->magic = THREAD_MAGIC;
@@ -634,7 +746,14 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (curr != next)
-    prev = switch_threads (curr, next);
+    {
+      trace_switch (curr->tid, next->tid, curr->status);
+      if (curr->status == THREAD_BLOCKED)
+        curr->usage.voluntary_switches++;
+      else if (curr->status == THREAD_READY)
+        curr->usage.involuntary_switches++;
+      prev = switch_threads (curr, next);
+    }
   schedule_tail (prev); 
 }
 
@@ -3,10 +3,13 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rusage.h>
 #include <stdint.h>
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "filesys/file.h"
 #include "filesys/directory.h"
+#include "userprog/fdtable.h"
 #include <hash.h>
 /* States in a thread's life cycle. */
 enum thread_status
@@ -115,26 +118,31 @@ struct thread
     struct semaphore wait_memory;
     struct semaphore wait_free;
     struct thread *parent;
-    struct semaphore wait_load;
-    //struct semaphore wait_process_start;
-    int process_started;
+    struct rusage usage;                /* Resources used. */
+    struct rusage child_usage;          /* Used by waited-for children. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
-    struct file* fd[128];
+    struct fd_table fds;                /* Open files. */
     struct file *current_executable;
     int child_exit_status[128];         //same index
     int exit_status;
 
-    struct hash *sup_page_dir;
+    struct sup_page_table *sup_page_dir;
     uint8_t *esp;
 
     //MMAP
     struct list mmap_list;
+    struct list vma_list;               /* Address space areas, by address. */
+
+    /* Owned by userprog/ioring.c. */
+    struct ioring_ctx *ioring;          /* Asynchronous I/O ring, if any. */
 #endif
     struct dir* curr_dir;
 
+    /* Owned by threads/malloc.c. */
+    struct magazine magazines[MALLOC_DESC_MAX]; /* Cached free blocks. */
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -154,7 +162,7 @@ extern bool thread_mlfqs;
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -172,6 +180,8 @@ void thread_yield (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, struct lock *, int priority);
+void thread_restore_priority (struct lock *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
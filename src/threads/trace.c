@@ -0,0 +1,98 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* If true, events are recorded.  Controlled by kernel
+   command-line option "-trace". */
+bool trace_enabled;
+
+/* Ring buffer of records.  The record for event number N is in
+   ring[N % TRACE_CNT]. */
+static struct trace_record ring[TRACE_CNT];
+
+/* Number of events recorded so far. */
+static uint32_t event_cnt;
+
+/* Appends a record of TYPE for thread TID to the ring. */
+static void
+record (enum trace_type type, int tid, uint32_t arg0, uint32_t arg1)
+{
+  struct trace_record *r;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  r = &ring[event_cnt++ % TRACE_CNT];
+  r->tick = timer_ticks ();
+  r->type = type;
+  r->tid = tid;
+  r->arg0 = arg0;
+  r->arg1 = arg1;
+  intr_set_level (old_level);
+}
+
+/* Records the name of the thread already running at startup,
+   which was created before tracing could see it. */
+void
+trace_init (void)
+{
+  if (trace_enabled)
+    trace_thread (thread_tid (), thread_name ());
+}
+
+/* Records an event of TYPE in the running thread. */
+void
+trace_event (enum trace_type type, uint32_t arg0, uint32_t arg1)
+{
+  if (trace_enabled)
+    record (type, thread_tid (), arg0, arg1);
+}
+
+/* Records that thread TID was created with the given NAME. */
+void
+trace_thread (int tid, const char *name)
+{
+  uint32_t words[2] = {0, 0};
+
+  if (!trace_enabled)
+    return;
+  strlcpy ((char *) words, name, sizeof words);
+  record (TRACE_THREAD, tid, words[0], words[1]);
+}
+
+/* Records a switch from thread TID, which is leaving the CPU
+   with the given STATUS, to thread NEXT_TID.  For use by the
+   scheduler, where thread_current() is not valid. */
+void
+trace_switch (int tid, int next_tid, int status)
+{
+  if (trace_enabled)
+    record (TRACE_SWITCH, tid, next_tid, status);
+}
+
+/* Copies up to MAX_CNT of the most recent records into RECORDS,
+   oldest first, and returns the number copied.  Stores the total
+   number of events recorded, including those overwritten, into
+   *EVENT_CNTP. */
+size_t
+trace_read (struct trace_record *records, size_t max_cnt,
+            uint32_t *event_cntp)
+{
+  enum intr_level old_level;
+  uint32_t first;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = event_cnt < TRACE_CNT ? event_cnt : TRACE_CNT;
+  if (cnt > max_cnt)
+    cnt = max_cnt;
+  first = event_cnt - cnt;
+  for (i = 0; i < cnt; i++)
+    records[i] = ring[(first + i) % TRACE_CNT];
+  *event_cntp = event_cnt;
+  intr_set_level (old_level);
+
+  return cnt;
+}
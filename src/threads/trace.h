@@ -0,0 +1,72 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   While trace_enabled is true (kernel option "-trace"), the
+   kernel appends one fixed-size record per event to a ring
+   buffer, overwriting the oldest records once it fills.  The
+   "trace FILE" action saves the buffer into the file system,
+   from which `pintos -g FILE' retrieves it, and
+   src/utils/pintos-trace decodes it. */
+
+/* Number of records kept.  Must be a power of 2. */
+#define TRACE_CNT 4096
+
+/* Event types.  ARG0 and ARG1 are as described. */
+enum trace_type
+  {
+    TRACE_THREAD,               /* Thread created: 1st 8 bytes of name. */
+    TRACE_SWITCH,               /* Switch: next tid, old thread's status. */
+    TRACE_FAULT,                /* Page fault: address, cause|result<<8. */
+    TRACE_SWAP_IN,              /* Swap in: user page, swap slot. */
+    TRACE_SWAP_OUT,             /* Swap out: user page, swap slot. */
+    TRACE_DISK,                 /* Disk command: sector, device<<8|cmd. */
+    TRACE_SYSCALL,              /* System call entry: number, 1st arg. */
+    TRACE_SYSRET                /* System call return: number, result. */
+  };
+
+/* How a TRACE_FAULT page fault was resolved. */
+enum trace_fault_result
+  {
+    TRACE_FAULT_STACK,          /* New stack page. */
+    TRACE_FAULT_SWAP,           /* Read back from swap. */
+    TRACE_FAULT_LOAD,           /* Loaded from a file or zeroed. */
+    TRACE_FAULT_FIXUP,          /* Failed user copy returned an error. */
+    TRACE_FAULT_KILL            /* Process killed. */
+  };
+
+/* One event, as stored in the buffer and in saved traces. */
+struct trace_record
+  {
+    uint32_t tick;              /* Timer ticks since boot. */
+    uint16_t type;              /* An enum trace_type. */
+    uint16_t tid;               /* Running thread, or new thread. */
+    uint32_t arg0;              /* Type-specific. */
+    uint32_t arg1;              /* Type-specific. */
+  };
+
+/* Header at the start of a saved trace, followed by RECORD_CNT
+   records from oldest to newest. */
+struct trace_header
+  {
+    char magic[4];              /* "TRC\0". */
+    uint32_t record_cnt;        /* Number of records that follow. */
+    uint32_t event_cnt;         /* Events logged, including overwritten. */
+    uint32_t timer_freq;        /* Timer ticks per second. */
+  };
+
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_event (enum trace_type, uint32_t arg0, uint32_t arg1);
+void trace_thread (int tid, const char *name);
+void trace_switch (int tid, int next_tid, int status);
+size_t trace_read (struct trace_record *, size_t max_cnt,
+                   uint32_t *event_cnt);
+
+#endif /* threads/trace.h */
@@ -2,8 +2,12 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
+#include "threads/latency.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/pte.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
@@ -14,9 +18,22 @@
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Latency of page faults, by how they were resolved: new stack
+   page, swapped in, or loaded. */
+static struct latency_profile fault_latency[TRACE_FAULT_LOAD + 1];
+
 static void kill (struct intr_frame *);
+static void debug_exception (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
+/* Labels in copy_user(), in syscall-entry.S. */
+void copy_user_insn (void);
+void copy_user_fixup (void);
+
+/* Labels in syscall_sysenter_entry(), in syscall-entry.S. */
+void syscall_sysenter_entry (void);
+void syscall_sysenter_clean (void);
+
 /* Registers handlers for interrupts that can be caused by user
    programs.
 
@@ -49,7 +66,7 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug_exception, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -64,6 +81,10 @@ exception_init (void)
      We need to disable interrupts for page faults because the
      fault address is stored in CR2 and needs to be preserved. */
   intr_register_int (14, 0, INTR_OFF, page_fault, "#PF Page-Fault Exception");
+
+  latency_profile (&fault_latency[TRACE_FAULT_STACK], "fault stack");
+  latency_profile (&fault_latency[TRACE_FAULT_SWAP], "fault evicted");
+  latency_profile (&fault_latency[TRACE_FAULT_LOAD], "fault load");
 }
 
 /* Prints exception statistics. */
@@ -114,6 +135,27 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Debug exception handler.  sysenter does not clear TF, so a
+   user process that sets TF and then executes sysenter takes a
+   single-step trap in the kernel, before syscall_sysenter_entry()
+   has loaded clean flags.  That trap is harmless: turn
+   single-stepping off and let the entry code go on.  Any other
+   debug exception is handled like other exceptions. */
+static void
+debug_exception (struct intr_frame *f) 
+{
+  uintptr_t eip = (uintptr_t) f->eip;
+
+  if (f->cs == SEL_KCSEG
+      && eip >= (uintptr_t) syscall_sysenter_entry
+      && eip < (uintptr_t) syscall_sysenter_clean)
+    {
+      f->eflags &= ~FLAG_TF;
+      return;
+    }
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -125,6 +167,33 @@ kill (struct intr_frame *f)
    can find more information about both of these in the
    description of "Interrupt 14--Page Fault Exception (#PF)" in
    [IA32-v3a] section 5.15 "Exception and Interrupt Reference". */
+/* If F is a kernel fault inside copy_user() that cannot be
+   satisfied, makes copy_user() return false and returns true.
+   Otherwise returns false. */
+static bool
+copy_user_fault (struct intr_frame *f, bool user)
+{
+  if (user || f->eip != copy_user_insn)
+    return false;
+  f->eip = copy_user_fixup;
+  f->eax = 0;
+  return true;
+}
+
+/* Records in the event trace that the fault at FAULT_ADDR
+   described by F, which began when rdtsc() returned START, was
+   resolved as RESULT, and adds its latency to the matching
+   profile. */
+static void
+fault_resolved (void *fault_addr, struct intr_frame *f, uint64_t start,
+                enum trace_fault_result result)
+{
+  trace_event (TRACE_FAULT, (uint32_t) fault_addr,
+               (f->error_code & (PF_P | PF_W | PF_U)) | (result << 8));
+  if (result <= TRACE_FAULT_LOAD)
+    latency_record (&fault_latency[result], start);
+}
+
 static void
 page_fault (struct intr_frame *f) 
 {
@@ -132,6 +201,7 @@ page_fault (struct intr_frame *f)
   bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
   void *fault_addr;  /* Fault address. */
+  uint64_t start = rdtsc ();
   /* Obtain faulting address, the virtual address that was
      accessed to cause the fault.  It may point to code or to
      data.  It is not necessarily the address of the instruction
@@ -155,9 +225,15 @@ page_fault (struct intr_frame *f)
   user = (f->error_code & PF_U) != 0;
   
   if(!not_present){
+    if(copy_user_fault(f, user)){
+      fault_resolved(fault_addr, f, start, TRACE_FAULT_FIXUP);
+      return;
+    }
+    fault_resolved(fault_addr, f, start, TRACE_FAULT_KILL);
     exit(-1);
   }
   if(user && is_kernel_vaddr(fault_addr)){
+    fault_resolved(fault_addr, f, start, TRACE_FAULT_KILL);
     exit(-1);
   }
   //esp handling
@@ -165,7 +241,7 @@ page_fault (struct intr_frame *f)
   uint32_t *pd = thread_current()->pagedir;
   struct sup_page_table_entry *spte;
 
-  spte = find_spte(fault_page);
+  spte = get_spte(fault_page);
 
   if(spte == NULL){
     if(((fault_addr < PHYS_BASE) && (PHYS_BASE - STACK_SIZE <= fault_addr)) && // USER AREA ??
@@ -174,24 +250,39 @@ page_fault (struct intr_frame *f)
     ){ //stack growth
       void *kernel = allocate_frame(fault_page);
       swap_prevent_off(fault_page);
+      thread_current()->usage.minor_faults++;
+      fault_resolved(fault_addr, f, start, TRACE_FAULT_STACK);
     }
 
     else{
       //ASSERT(0);
+      if(copy_user_fault(f, user)){
+        fault_resolved(fault_addr, f, start, TRACE_FAULT_FIXUP);
+        return;
+      }
+      fault_resolved(fault_addr, f, start, TRACE_FAULT_KILL);
       exit(-1);
     }
   }
   
   else if(spte->state == SPTE_EVICTED){
-    lock_acquire(&frame_table_lock);
+    mutex_acquire(&frame_table_lock);
     swap_in(fault_page, spte);
-    lock_release(&frame_table_lock);
+    mutex_release(&frame_table_lock);
+    thread_current()->usage.major_faults++;
+    fault_resolved(fault_addr, f, start, TRACE_FAULT_SWAP);
   }
 
   else if(spte->state == SPTE_LOAD){
+    /* Only pages with file data to read count as major. */
+    if(spte->page_read_bytes > 0)
+      thread_current()->usage.major_faults++;
+    else
+      thread_current()->usage.minor_faults++;
     lock_acquire(&filesys_lock);
     lazy_load_page(spte);
     lock_release(&filesys_lock);
+    fault_resolved(fault_addr, f, start, TRACE_FAULT_LOAD);
   }
 }
 
@@ -0,0 +1,150 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+
+/* Slots allocated the first time a file is opened. */
+#define FD_INITIAL_CAPACITY 16
+
+/* Initializes T as an empty table that will hold at most LIMIT
+   open files, or FD_LIMIT_DEFAULT if LIMIT is 0.  Nothing is
+   allocated until the first file is installed. */
+void
+fd_table_init (struct fd_table *t, size_t limit)
+{
+  t->files = NULL;
+  t->used = NULL;
+  t->capacity = 0;
+  t->limit = limit != 0 ? limit : FD_LIMIT_DEFAULT;
+}
+
+/* Frees T's slot arrays.  The files in T must already have been
+   closed. */
+void
+fd_table_destroy (struct fd_table *t)
+{
+  ASSERT (t->used == NULL || bitmap_none (t->used, 0, t->capacity));
+
+  free (t->files);
+  if (t->used != NULL)
+    bitmap_destroy (t->used);
+  fd_table_init (t, t->limit);
+}
+
+/* Grows T to at least one more slot, doubling its capacity but
+   not past its limit.  Returns false if T is at its limit or
+   memory is short. */
+static bool
+grow (struct fd_table *t)
+{
+  size_t new_capacity;
+  struct file **files;
+  struct bitmap *used;
+  size_t i;
+
+  if (t->capacity >= t->limit)
+    return false;
+  new_capacity = t->capacity != 0 ? t->capacity * 2 : FD_INITIAL_CAPACITY;
+  if (new_capacity > t->limit)
+    new_capacity = t->limit;
+
+  files = realloc (t->files, new_capacity * sizeof *files);
+  if (files == NULL)
+    return false;
+  t->files = files;
+  used = bitmap_create (new_capacity);
+  if (used == NULL)
+    return false;
+  if (t->used != NULL)
+    {
+      for (i = 0; i < t->capacity; i++)
+        bitmap_set (used, i, bitmap_test (t->used, i));
+      bitmap_destroy (t->used);
+    }
+  memset (files + t->capacity, 0,
+          (new_capacity - t->capacity) * sizeof *files);
+  t->used = used;
+  t->capacity = new_capacity;
+  return true;
+}
+
+/* Puts FILE in the lowest free slot of T and returns its file
+   descriptor, or -1 if T is full. */
+int
+fd_install (struct fd_table *t, struct file *file)
+{
+  size_t idx;
+
+  ASSERT (file != NULL);
+
+  idx = t->used != NULL ? bitmap_scan_and_flip (t->used, 0, 1, false)
+                        : BITMAP_ERROR;
+  if (idx != BITMAP_ERROR && idx >= t->limit)
+    {
+      /* The limit was lowered below the capacity. */
+      bitmap_reset (t->used, idx);
+      return -1;
+    }
+  if (idx == BITMAP_ERROR)
+    {
+      idx = t->capacity;
+      if (!grow (t))
+        return -1;
+      bitmap_mark (t->used, idx);
+    }
+  t->files[idx] = file;
+  return idx + FD_BASE;
+}
+
+/* Returns the file open as FD in T, or a null pointer if FD is
+   not open. */
+struct file *
+fd_lookup (const struct fd_table *t, int fd)
+{
+  size_t idx = (unsigned) fd - FD_BASE;
+  return idx < t->capacity ? t->files[idx] : NULL;
+}
+
+/* Removes FD from T and returns the file that was open as FD, or
+   a null pointer if FD is not open.  The file is not closed. */
+struct file *
+fd_remove (struct fd_table *t, int fd)
+{
+  struct file *file = fd_lookup (t, fd);
+
+  if (file != NULL)
+    {
+      size_t idx = fd - FD_BASE;
+      t->files[idx] = NULL;
+      bitmap_reset (t->used, idx);
+    }
+  return file;
+}
+
+/* Returns the lowest open file descriptor in T, or -1 if no file
+   is open. */
+int
+fd_first (const struct fd_table *t)
+{
+  size_t idx;
+
+  if (t->used == NULL)
+    return -1;
+  idx = bitmap_scan (t->used, 0, 1, true);
+  return idx != BITMAP_ERROR ? (int) idx + FD_BASE : -1;
+}
+
+/* Sets the most files T may hold open to LIMIT.  Fails if LIMIT
+   is 0 or above FD_LIMIT_MAX, or if a descriptor that LIMIT would
+   rule out is open. */
+bool
+fd_set_limit (struct fd_table *t, size_t limit)
+{
+  if (limit == 0 || limit > FD_LIMIT_MAX)
+    return false;
+  if (limit < t->capacity && bitmap_any (t->used, limit, t->capacity - limit))
+    return false;
+  t->limit = limit;
+  return true;
+}
@@ -0,0 +1,37 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct bitmap;
+struct file;
+
+/* Lowest file descriptor given to a file.  0, 1 and 2 are the
+   console. */
+#define FD_BASE 3
+
+/* Default and largest limits on a process's open files. */
+#define FD_LIMIT_DEFAULT 128
+#define FD_LIMIT_MAX 4096
+
+/* A process's open files.  The slot arrays live in the kernel
+   heap, not in the thread's page, and double in size as they fill
+   up, to at most LIMIT slots. */
+struct fd_table
+  {
+    struct file **files;        /* Open files, indexed by fd - FD_BASE. */
+    struct bitmap *used;        /* One bit per slot, set if in use. */
+    size_t capacity;            /* Number of slots. */
+    size_t limit;               /* Most files that may be open at once. */
+  };
+
+void fd_table_init (struct fd_table *, size_t limit);
+void fd_table_destroy (struct fd_table *);
+int fd_install (struct fd_table *, struct file *);
+struct file *fd_lookup (const struct fd_table *, int fd);
+struct file *fd_remove (struct fd_table *, int fd);
+int fd_first (const struct fd_table *);
+bool fd_set_limit (struct fd_table *, size_t limit);
+
+#endif /* userprog/fdtable.h */
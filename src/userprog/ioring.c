@@ -0,0 +1,504 @@
+#include "userprog/ioring.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/exception.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/vma.h"
+
+/* Asynchronous I/O rings.
+
+   Each process may set up one ring, a page shared with the
+   kernel (see lib/ioring.h).  ioring_enter() takes the queued
+   submission entries in the context of the process, where the fd
+   table and the user address space are at hand.  Open, close and
+   no-op entries complete right away.  For reads and writes the
+   user buffer is pinned and the file is reopened, so that the
+   request no longer depends on the process; the request then
+   goes to a small pool of kernel worker threads, which copy
+   between the file and the pinned frames and post the
+   completion.
+
+   A ring's in-flight requests together pin at most
+   IORING_MAX_PINNED pages; submission waits for earlier requests
+   to complete before pinning more, so that a process cannot tie
+   down an unbounded share of memory.
+
+   A ring's requests are serviced one at a time, in submission
+   order, so an fsync entry completes only after every write
+   submitted before it.  Writes go straight to disk, so fsync has
+   nothing else to do.  Different rings are serviced in
+   parallel. */
+
+/* Number of worker threads serving all rings. */
+#define IORING_WORKERS 2
+
+/* Most pages spanned by one read or write buffer. */
+#define IORING_MAX_PAGES (IORING_MAX_LEN / PGSIZE + 1)
+
+/* Most pages pinned at once by one ring's requests.  Must be at
+   least IORING_MAX_PAGES. */
+#define IORING_MAX_PINNED (2 * IORING_MAX_PAGES)
+
+/* User address of a process's ring: the page just below the
+   largest stack the page fault handler will grow. */
+#define IORING_UADDR ((uint8_t *) PHYS_BASE - STACK_SIZE - PGSIZE)
+
+/* Kernel side of a process's ring. */
+struct ioring_ctx
+  {
+    struct ioring *shared;      /* Kernel address of the shared page. */
+    uint32_t sq_head;           /* Private copy of shared->sq_head. */
+    uint32_t cq_tail;           /* Private copy of shared->cq_tail. */
+    unsigned inflight;          /* Requests not yet completed. */
+    size_t pinned;              /* Pages pinned by those requests. */
+    struct list pending;        /* Requests waiting for a worker. */
+    bool queued;                /* On ready_rings? */
+    bool busy;                  /* A worker is servicing a request? */
+    struct vma *vma;            /* Reserves the ring's user page. */
+    struct list_elem elem;      /* ready_rings element. */
+    struct condition done;      /* Signaled on each completion. */
+  };
+
+/* A read, write or fsync handed to the workers. */
+struct ioring_req
+  {
+    struct list_elem elem;      /* ioring_ctx's pending list element. */
+    struct ioring_sqe sqe;      /* Copy of the submission entry. */
+    struct file *file;          /* The request's own handle on the file. */
+    size_t page_cnt;            /* Number of pinned buffer pages. */
+    struct frame_table_entry *ftes[IORING_MAX_PAGES]; /* Pinned pages. */
+  };
+
+/* Protects every ring's kernel state and ready_rings. */
+static struct lock ioring_lock;
+static struct lock_profile ioring_lock_profile;
+
+/* Rings with pending requests and no worker servicing them. */
+static struct list ready_rings;
+static struct condition work_ready;
+
+static struct slab_cache *req_cache;
+
+static void worker (void *aux);
+
+/* Starts the worker threads. */
+void
+ioring_init (void)
+{
+  int i;
+
+  ASSERT (sizeof (struct ioring) <= PGSIZE);
+
+  lock_init (&ioring_lock);
+  lock_profile (&ioring_lock, &ioring_lock_profile, "ioring");
+  list_init (&ready_rings);
+  cond_init (&work_ready);
+  req_cache = slab_cache_create ("ioring_req", sizeof (struct ioring_req),
+                                 NULL);
+  if (req_cache == NULL)
+    PANIC ("ioring_init: can't create request cache");
+  for (i = 0; i < IORING_WORKERS; i++)
+    if (thread_create ("ioring", PRI_DEFAULT, worker, NULL) == TID_ERROR)
+      PANIC ("ioring_init: can't start worker thread");
+}
+
+/* Maps a new ring into the current process and returns its user
+   address, or a null pointer if the process already has a ring
+   or memory is short. */
+struct ioring *
+ioring_setup (void)
+{
+  struct thread *t = thread_current ();
+  struct ioring_ctx *ctx;
+
+  if (t->ioring != NULL
+      || find_spte (IORING_UADDR) != NULL
+      || pagedir_get_page (t->pagedir, IORING_UADDR) != NULL)
+    return NULL;
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return NULL;
+  ctx->vma = vma_add (IORING_UADDR, PGSIZE, NULL, 0, 0, true);
+  if (ctx->vma == NULL)
+    {
+      free (ctx);
+      return NULL;
+    }
+  ctx->shared = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (ctx->shared == NULL)
+    {
+      vma_remove (ctx->vma);
+      free (ctx);
+      return NULL;
+    }
+  if (!pagedir_set_page (t->pagedir, IORING_UADDR, ctx->shared, true))
+    {
+      palloc_free_page (ctx->shared);
+      vma_remove (ctx->vma);
+      free (ctx);
+      return NULL;
+    }
+
+  ctx->sq_head = ctx->cq_tail = 0;
+  ctx->inflight = 0;
+  ctx->pinned = 0;
+  list_init (&ctx->pending);
+  ctx->queued = ctx->busy = false;
+  cond_init (&ctx->done);
+  t->ioring = ctx;
+  return (struct ioring *) IORING_UADDR;
+}
+
+/* Returns the number of completions posted to CTX's ring and not
+   yet consumed by the process.  The process owns cq_head, so a
+   nonsensical value is taken to mean a full queue. */
+static uint32_t
+cq_unread (const struct ioring_ctx *ctx)
+{
+  uint32_t unread = ctx->cq_tail - ctx->shared->cq_head;
+  return unread <= IORING_ENTRIES ? unread : IORING_ENTRIES;
+}
+
+/* Posts a completion with USER_DATA and RES to CTX's ring and
+   wakes anyone waiting for it.  ioring_lock must be held. */
+static void
+post (struct ioring_ctx *ctx, uint32_t user_data, int res)
+{
+  struct ioring_cqe *cqe;
+
+  ASSERT (lock_held_by_current_thread (&ioring_lock));
+
+  cqe = &ctx->shared->cq[ctx->cq_tail % IORING_ENTRIES];
+  cqe->user_data = user_data;
+  cqe->res = res;
+  barrier ();
+  ctx->shared->cq_tail = ++ctx->cq_tail;
+  cond_broadcast (&ctx->done, &ioring_lock);
+}
+
+/* Puts CTX on ready_rings for the next free worker.
+   ioring_lock must be held. */
+static void
+make_ready (struct ioring_ctx *ctx)
+{
+  ctx->queued = true;
+  list_push_back (&ready_rings, &ctx->elem);
+  cond_signal (&work_ready, &ioring_lock);
+}
+
+/* Waits until CTX's requests have few enough pages pinned that
+   PAGE_CNT more stay within IORING_MAX_PINNED, then counts them
+   against CTX. */
+static void
+reserve_pins (struct ioring_ctx *ctx, size_t page_cnt)
+{
+  ASSERT (page_cnt <= IORING_MAX_PINNED);
+
+  lock_acquire (&ioring_lock);
+  while (ctx->pinned + page_cnt > IORING_MAX_PINNED)
+    cond_wait (&ctx->done, &ioring_lock);
+  ctx->pinned += page_cnt;
+  lock_release (&ioring_lock);
+}
+
+/* Gives back PAGE_CNT pages counted by reserve_pins() for CTX. */
+static void
+unreserve_pins (struct ioring_ctx *ctx, size_t page_cnt)
+{
+  lock_acquire (&ioring_lock);
+  ASSERT (ctx->pinned >= page_cnt);
+  ctx->pinned -= page_cnt;
+  cond_broadcast (&ctx->done, &ioring_lock);
+  lock_release (&ioring_lock);
+}
+
+/* Readies REQ, a read, write or fsync submitted to CTX, for a
+   worker: pins its buffer and takes a private handle on its file.
+   Returns false if the entry is invalid. */
+static bool
+prepare (struct ioring_ctx *ctx, struct ioring_req *req)
+{
+  const struct ioring_sqe *sqe = &req->sqe;
+  struct thread *t = thread_current ();
+  bool is_read = sqe->op == IORING_OP_READ;
+  struct file *file;
+  void *upages[IORING_MAX_PAGES];
+  size_t i;
+
+  file = fd_lookup (&t->fds, sqe->fd);
+  if (file == NULL)
+    return false;
+
+  req->page_cnt = 0;
+  if (sqe->op != IORING_OP_FSYNC)
+    {
+      uint8_t *start = sqe->buf;
+      uint8_t *end = start + sqe->len;
+
+      if (sqe->len > IORING_MAX_LEN || end < start
+          || (sqe->op == IORING_OP_WRITE && file->deny_write))
+        return false;
+      if (sqe->len > 0)
+        req->page_cnt = (pg_no (end - 1) - pg_no (start)) + 1;
+      for (i = 0; i < req->page_cnt; i++)
+        upages[i] = (uint8_t *) pg_round_down (start) + i * PGSIZE;
+      reserve_pins (ctx, req->page_cnt);
+      if (!frame_pin_user (upages, req->page_cnt, is_read, req->ftes))
+        {
+          unreserve_pins (ctx, req->page_cnt);
+          return false;
+        }
+    }
+
+  lock_acquire (&filesys_lock);
+  req->file = file_reopen (file);
+  lock_release (&filesys_lock);
+  if (req->file == NULL)
+    {
+      frame_unpin_user (req->ftes, req->page_cnt, false);
+      unreserve_pins (ctx, req->page_cnt);
+      return false;
+    }
+  return true;
+}
+
+/* Opens the file named by the string at user address UPATH,
+   copying the name in first.  Returns the new file descriptor,
+   or -1 if UPATH is not a valid string or the open fails. */
+static int
+open_user (const char *upath)
+{
+  char *path;
+  int len, fd = -1;
+
+  path = palloc_get_page (0);
+  if (path == NULL)
+    return -1;
+  len = strncpy_from_user (path, upath, PGSIZE);
+  if (len >= 0 && len < PGSIZE)
+    fd = open (path);
+  palloc_free_page (path);
+  return fd;
+}
+
+/* Carries out SQE, which the current process just submitted to
+   CTX. */
+static void
+submit (struct ioring_ctx *ctx, const struct ioring_sqe *sqe)
+{
+  struct thread *t = thread_current ();
+  struct ioring_req *req;
+  int res;
+
+  switch (sqe->op)
+    {
+    case IORING_OP_NOP:
+      res = 0;
+      break;
+
+    case IORING_OP_OPEN:
+      res = open_user (sqe->buf);
+      break;
+
+    case IORING_OP_CLOSE:
+      res = -1;
+      if (fd_lookup (&t->fds, sqe->fd) != NULL)
+        {
+          close (sqe->fd);
+          res = 0;
+        }
+      break;
+
+    case IORING_OP_READ:
+    case IORING_OP_WRITE:
+    case IORING_OP_FSYNC:
+      req = slab_alloc (req_cache);
+      res = -1;
+      if (req == NULL)
+        break;
+      req->sqe = *sqe;
+      if (!prepare (ctx, req))
+        {
+          slab_free (req_cache, req);
+          break;
+        }
+      lock_acquire (&ioring_lock);
+      ctx->inflight++;
+      list_push_back (&ctx->pending, &req->elem);
+      if (!ctx->queued && !ctx->busy)
+        make_ready (ctx);
+      lock_release (&ioring_lock);
+      return;
+
+    default:
+      res = -1;
+      break;
+    }
+
+  lock_acquire (&ioring_lock);
+  post (ctx, sqe->user_data, res);
+  lock_release (&ioring_lock);
+}
+
+/* Submits up to TO_SUBMIT queued entries from the current
+   process's ring, then waits until at least MIN_COMPLETE
+   completions are ready to consume or nothing is left in flight.
+   Entries are not taken while the completion queue lacks room for
+   one more result.  Returns the number of entries submitted, or -1
+   if the process has no ring. */
+int
+ioring_enter (unsigned to_submit, unsigned min_complete)
+{
+  struct ioring_ctx *ctx = thread_current ()->ioring;
+  struct ioring *ring;
+  int submitted = 0;
+
+  if (ctx == NULL)
+    return -1;
+  ring = ctx->shared;
+  if (min_complete > IORING_ENTRIES)
+    min_complete = IORING_ENTRIES;
+
+  while ((unsigned) submitted < to_submit && ctx->sq_head != ring->sq_tail)
+    {
+      struct ioring_sqe sqe;
+      bool room;
+
+      lock_acquire (&ioring_lock);
+      room = ctx->inflight + cq_unread (ctx) < IORING_ENTRIES;
+      lock_release (&ioring_lock);
+      if (!room)
+        break;
+
+      /* Copy the entry out before using it; the process may
+         change the shared page at any time. */
+      barrier ();
+      sqe = ring->sq[ctx->sq_head % IORING_ENTRIES];
+      ring->sq_head = ++ctx->sq_head;
+      submit (ctx, &sqe);
+      submitted++;
+    }
+
+  lock_acquire (&ioring_lock);
+  while (ctx->inflight > 0 && cq_unread (ctx) < min_complete)
+    cond_wait (&ctx->done, &ioring_lock);
+  lock_release (&ioring_lock);
+  return submitted;
+}
+
+/* Copies between REQ's file and its pinned buffer, then releases
+   both.  Runs in a worker thread.  Returns the number of bytes
+   transferred. */
+static int
+service (struct ioring_req *req)
+{
+  const struct ioring_sqe *sqe = &req->sqe;
+  bool is_read = sqe->op == IORING_OP_READ;
+  size_t ofs = pg_ofs (sqe->buf);
+  size_t left = sqe->len;
+  off_t pos = sqe->offset;
+  int total = 0;
+  size_t i;
+
+  lock_acquire (&filesys_lock);
+  for (i = 0; i < req->page_cnt; i++)
+    {
+      uint8_t *kaddr = (uint8_t *) req->ftes[i]->kernel + ofs;
+      size_t n = left < PGSIZE - ofs ? left : PGSIZE - ofs;
+      off_t len = (is_read
+                   ? file_read_at (req->file, kaddr, n, pos)
+                   : file_write_at (req->file, kaddr, n, pos));
+
+      total += len;
+      pos += len;
+      left -= n;
+      ofs = 0;
+      if ((size_t) len < n)
+        break;
+    }
+  file_close (req->file);
+  lock_release (&filesys_lock);
+  frame_unpin_user (req->ftes, req->page_cnt, is_read);
+  return total;
+}
+
+/* Worker thread.  Takes one request at a time from the ring at
+   the front of ready_rings, so that busy rings take turns. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct ioring_ctx *ctx;
+      struct ioring_req *req;
+      int res;
+
+      lock_acquire (&ioring_lock);
+      while (list_empty (&ready_rings))
+        cond_wait (&work_ready, &ioring_lock);
+      ctx = list_entry (list_pop_front (&ready_rings), struct ioring_ctx, elem);
+      req = list_entry (list_pop_front (&ctx->pending),
+                        struct ioring_req, elem);
+      ctx->queued = false;
+      ctx->busy = true;
+      lock_release (&ioring_lock);
+
+      res = service (req);
+
+      lock_acquire (&ioring_lock);
+      ctx->pinned -= req->page_cnt;
+      post (ctx, req->sqe.user_data, res);
+      ctx->inflight--;
+      ctx->busy = false;
+      if (!list_empty (&ctx->pending))
+        make_ready (ctx);
+      lock_release (&ioring_lock);
+      slab_free (req_cache, req);
+    }
+}
+
+/* Waits until every request the current process submitted to its
+   ring has completed, so that no worker still uses its pages. */
+void
+ioring_quiesce (void)
+{
+  struct ioring_ctx *ctx = thread_current ()->ioring;
+
+  if (ctx == NULL)
+    return;
+  lock_acquire (&ioring_lock);
+  while (ctx->inflight > 0)
+    cond_wait (&ctx->done, &ioring_lock);
+  lock_release (&ioring_lock);
+}
+
+/* Tears down the current process's ring, if any, once its
+   requests have completed.  Must be called before the process's
+   frames are freed and without filesys_lock held. */
+void
+ioring_destroy (void)
+{
+  struct thread *t = thread_current ();
+  struct ioring_ctx *ctx = t->ioring;
+
+  if (ctx == NULL)
+    return;
+  ioring_quiesce ();
+  pagedir_clear_page (t->pagedir, IORING_UADDR);
+  palloc_free_page (ctx->shared);
+  vma_remove (ctx->vma);
+  free (ctx);
+  t->ioring = NULL;
+}
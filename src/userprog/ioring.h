@@ -0,0 +1,12 @@
+#ifndef USERPROG_IORING_H
+#define USERPROG_IORING_H
+
+#include <ioring.h>
+
+void ioring_init (void);
+struct ioring *ioring_setup (void);
+int ioring_enter (unsigned to_submit, unsigned min_complete);
+void ioring_quiesce (void);
+void ioring_destroy (void);
+
+#endif /* userprog/ioring.h */
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "userprog/gdt.h"
+#include "userprog/ioring.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
@@ -14,35 +15,74 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "userprog/syscall.h"
 #include "vm/page.h"
+#include "vm/vma.h"
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (struct file *file, void (**eip) (void), void **esp);
 
-struct lock_and_name {
-  struct lock lock;
-  char *file_name;
-};
+/* Handed by process_execute() to the new thread, on the parent's
+   stack.  The child may touch it only until it ups LOADED. */
+struct spawn
+  {
+    struct file *file;          /* Executable, opened by the parent. */
+    char *args;                 /* Argument strings, back to back. */
+    size_t args_len;            /* Bytes in ARGS, counting null bytes. */
+    int argc;                   /* Number of strings in ARGS. */
+    bool success;               /* Set by the child: loaded? */
+    struct semaphore loaded;    /* Upped by the child once loaded. */
+  };
 
-/* A function that parse the start_process()'s input */
-int
-parse_instruction(char *input ,char **output){
-  ASSERT(input!=NULL);
-  char *save_ptr;
-  char *token;
-  int index = 0;
-  for (token = strtok_r(input," ",&save_ptr); token != NULL;
-     token = strtok_r (NULL, " ", &save_ptr)){
-    output[index]=token;
-    index++;
-  }
-  return index;
-} 
+/* Splits CMD_LINE at spaces into a new block of null-terminated
+   strings, stored back to back in the order they will sit on the
+   user stack.  Sets *ARGC to the number of strings and *LEN to
+   the block's size.  Returns the block, or a null pointer if
+   CMD_LINE is empty, memory is short, or the arguments would not
+   fit in the initial stack page. */
+static char *
+split_args (const char *cmd_line, int *argc, size_t *len)
+{
+  size_t max = strnlen (cmd_line, PGSIZE) + 1;
+  char *args, *dst;
+  const char *src;
+
+  args = malloc (max);
+  if (args == NULL)
+    return NULL;
+
+  *argc = 0;
+  dst = args;
+  for (src = cmd_line; *src != '\0'; )
+    {
+      if (*src == ' ')
+        {
+          src++;
+          continue;
+        }
+      while (*src != ' ' && *src != '\0' && dst < args + max - 1)
+        *dst++ = *src++;
+      *dst++ = '\0';
+      ++*argc;
+      if (dst >= args + max)
+        break;
+    }
+  *len = dst - args;
+
+  /* Strings, padding, argv[], and argv, argc and return address. */
+  if (*argc == 0
+      || ROUND_UP (*len, 4) + (*argc + 4) * sizeof (char *) > PGSIZE)
+    {
+      free (args);
+      return NULL;
+    }
+  return args;
+}
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -51,146 +91,113 @@ parse_instruction(char *input ,char **output){
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
-  char *fn_copy_2;
+  struct spawn spawn;
   tid_t tid;
-  char* argv[50];
-  struct lock_and_name lan;
-  lock_init(&lan.lock);
-  struct file* file;
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  fn_copy_2 = palloc_get_page(0);
-  if (fn_copy == NULL || fn_copy_2 == NULL){
-    palloc_free_page(fn_copy_2);
-    palloc_free_page(fn_copy);
-    return TID_ERROR;
-  }
-  strlcpy (fn_copy, file_name, PGSIZE);
-  strlcpy (fn_copy_2, file_name, PGSIZE);
-  lan.file_name = fn_copy;
-
-  parse_instruction(fn_copy_2,argv);
-  lock_acquire(&filesys_lock);
-  if (!(file = filesys_open (argv[0]))) {
-    palloc_free_page(fn_copy);
-    palloc_free_page (fn_copy_2); 
-    lock_release(&filesys_lock);
-    return TID_ERROR;
-  }
-  file_close(file);
-  lock_release(&filesys_lock);
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (argv[0], PRI_DEFAULT, start_process, &lan);
-  palloc_free_page (fn_copy_2); 
-
-  /* thread create fail */
-  if (tid == TID_ERROR){
-    palloc_free_page (fn_copy);
-    return tid; 
-  }
 
-  /* wait child thread to finish load */
-  sema_down(&thread_current()->wait_load);
-  if(!thread_current()->process_started){
-    palloc_free_page (fn_copy);
-    process_wait(tid); // returns -1
+  /* Parse the command line once, into a block the child copies
+     onto its stack as is. */
+  spawn.args = split_args (file_name, &spawn.argc, &spawn.args_len);
+  if (spawn.args == NULL)
     return TID_ERROR;
-  }
-  
-  lock_acquire(&lan.lock);
-  palloc_free_page (fn_copy);
-  /* lock check*/
-  lock_release(&lan.lock);
 
-  return tid;
-}
+  /* Open the executable here and hand it to the child, which
+     then needn't look up its name again. */
+  lock_acquire (&filesys_lock);
+  spawn.file = filesys_open (spawn.args);
+  lock_release (&filesys_lock);
+  if (spawn.file == NULL)
+    {
+      free (spawn.args);
+      return TID_ERROR;
+    }
+  sema_init (&spawn.loaded, 0);
 
+  /* Create a new thread to execute FILE_NAME.  From here on the
+     child owns FILE and ARGS. */
+  tid = thread_create (spawn.args, PRI_DEFAULT, start_process, &spawn);
+  if (tid == TID_ERROR)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (spawn.file);
+      lock_release (&filesys_lock);
+      free (spawn.args);
+      return TID_ERROR;
+    }
 
+  /* Wait only for the load result. */
+  sema_down (&spawn.loaded);
+  if (!spawn.success)
+    {
+      process_wait (tid);       /* Reap the child, which is exiting. */
+      return TID_ERROR;
+    }
+  return tid;
+}
 
-/* A function that push argument into stack and modify esp */
-void
-stack_build(void **esp,char **argv,int argc){
-  int align_manage = 0;
+/* Builds the initial user stack below *ESP from the ARGC
+   argument strings in the LEN-byte block ARGS, as made by
+   split_args(): the strings, copied in one piece and padded to a
+   word boundary, then argv[], argv, argc and a fake return
+   address. */
+static void
+stack_build (void **esp, const char *args, size_t len, int argc)
+{
+  char *strings;
+  char **argv;
   int i;
-  /* push argv[max] argv[max-1] ... argv[1] */
-  for(i=argc-1;i>=0;i--){
-    int len = strlen(argv[i]) + 1;
-    *esp -= len;
-    align_manage += len;
-    strlcpy(*esp,argv[i],len);
-    argv[i] = *esp; // if this line doesn't exist, kernel panic occurs
-  }
 
-  /* push align zero */
-  align_manage = 4 - align_manage % 4;
-  if( align_manage != 4){
-    *esp -= align_manage;
-  }
-  /* NULL pointer */
-  *esp -= sizeof(char *);
-  memset(*esp,0,sizeof(char *));
-
-  /* push argv pointer */
-  for(i=argc-1;i>=0;i--){
-    *esp -= sizeof(char *);
-    **(char ***)esp = argv[i]; 
-  }
+  strings = (char *) *esp - len;
+  memcpy (strings, args, len);
 
-  /* push argv itself */
-  *esp -= sizeof(char **);
-  **(char ****)esp = *esp + sizeof(char **);
-
-  /* push argc */
-  *esp -= sizeof(int);
-  **(int **)esp = argc;
-
-  /* push ret */
-  *esp -= sizeof(void *);
-  **(uint32_t **)esp = 0;
-
-  /* for debugging
-  printf("esp: %x\n",*esp);
-  hex_dump(*esp,*esp,100,1);a
-  */
+  argv = (char **) ((uintptr_t) strings & ~3u) - (argc + 1);
+  for (i = 0; i < argc; i++)
+    {
+      argv[i] = strings;
+      strings += strlen (strings) + 1;
+    }
+  argv[argc] = NULL;
+
+  *esp = argv;
+  *esp -= sizeof (char **);
+  *(char ***) *esp = argv;
+  *esp -= sizeof (int);
+  *(int *) *esp = argc;
+  *esp -= sizeof (void *);
+  *(void **) *esp = NULL;
 }
 
 /* A thread function that loads a user process and makes it start
    running. */
 static void
-start_process (void *lan_)
+start_process (void *spawn_)
 {
-  struct lock_and_name *lan = lan_;
-  char *file_name = lan->file_name;
+  struct spawn *spawn = spawn_;
+  char *args = spawn->args;
+  size_t args_len = spawn->args_len;
+  int argc = spawn->argc;
   struct intr_frame if_;
   bool success;
-  char* argv[50]; //file names are limited to 14 characters + NULL
-  int argc;
-  /* acquire lock */
-  lock_acquire(&lan->lock);
 
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-   /* parse file_name */
-  argc = parse_instruction(file_name, argv);
 
-  page_init();
   thread_current()->curr_dir = dir_open_root();
 
-  success = load (argv[0], &if_.eip, &if_.esp);
-  sema_up(&thread_current()->parent->wait_load);
-  if(success)
-    stack_build(&if_.esp,argv,argc);
+  success = load (spawn->file, &if_.eip, &if_.esp);
+
+  /* Let the parent go.  SPAWN is gone after this. */
+  spawn->success = success;
+  sema_up (&spawn->loaded);
+
+  if (success)
+    stack_build (&if_.esp, args, args_len, argc);
+  free (args);
   /* If load failed, quit. */
-  lock_release(&lan->lock);
-  if (!success) {
+  if (!success)
     thread_exit ();
-  }
-  thread_current()->parent->process_started = 1;
 
   /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
@@ -203,6 +210,22 @@ start_process (void *lan_)
   NOT_REACHED ();
 }
 
+/* Adds the resource usage in SRC to DST. */
+static void
+rusage_add (struct rusage *dst, const struct rusage *src)
+{
+  dst->user_ticks += src->user_ticks;
+  dst->kernel_ticks += src->kernel_ticks;
+  dst->major_faults += src->major_faults;
+  dst->minor_faults += src->minor_faults;
+  dst->swap_ins += src->swap_ins;
+  dst->swap_outs += src->swap_outs;
+  dst->sectors_read += src->sectors_read;
+  dst->sectors_written += src->sectors_written;
+  dst->voluntary_switches += src->voluntary_switches;
+  dst->involuntary_switches += src->involuntary_switches;
+}
+
 /* This is 2016 spring cs330 skeleton code */
 
 /* Waits for thread TID to die and returns its exit status.  If
@@ -242,19 +265,19 @@ void
 process_exit (void)
 {
   struct thread *curr = thread_current ();
+  enum intr_level old_level;
   uint32_t *pd;
   file_close(curr->current_executable);
 
   if(lock_held_by_current_thread(&filesys_lock))
     lock_release(&filesys_lock);
-  if(lock_held_by_current_thread(&frame_table_lock))
-    lock_release(&frame_table_lock);
-  int i;
-  for(i = 0; i < 128; ++i){
-    if(curr->fd[i]){
-      close(i+3);
-    }
-  }
+  if(mutex_held_by_current_thread(&frame_table_lock))
+    mutex_release(&frame_table_lock);
+  ioring_destroy ();
+  int fd;
+  while((fd = fd_first(&curr->fds)) >= 0)
+    close(fd);
+  fd_table_destroy(&curr->fds);
   dir_close(curr->curr_dir);
 
   while(list_size(&curr->mmap_list)){
@@ -270,7 +293,7 @@ process_exit (void)
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   /* destroy spt */
-  lock_acquire(&frame_table_lock);
+  mutex_acquire(&frame_table_lock);
   pd = curr->pagedir;
   if (pd != NULL) 
     {
@@ -282,13 +305,23 @@ process_exit (void)
          directory, or our active page directory will be one
          that's been freed (and cleared). */
       destroy_sup_page_table();
+      vma_destroy();
       deallocate_frame_owned_by_thread();
       curr->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* Our parent waits in process_wait() until wait_free, so it is
+     still there to charge with our usage, including the teardown
+     above.  Turn off interrupts so that the timer does not
+     update our tick counts midway. */
+  old_level = intr_disable ();
+  rusage_add (&curr->parent->child_usage, &curr->usage);
+  rusage_add (&curr->parent->child_usage, &curr->child_usage);
+  intr_set_level (old_level);
   sema_up(&curr->wait_free);
-  lock_release(&frame_table_lock);
+  mutex_release(&frame_table_lock);
   if(lock_held_by_current_thread(&filesys_lock))
     lock_release(&filesys_lock);
 }
@@ -378,60 +411,92 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
-   and its initial stack pointer into *ESP.
-   Returns true if successful, false otherwise. */
-bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+/* Executable image cache.
+
+   Parsing an executable means reading its ELF header and every
+   program header and validating each loadable segment.  The
+   result depends only on the file's contents, so it is kept,
+   keyed by inode, for the next exec of the same program.  The
+   cache holds each inode open so that the inode's write count
+   (see inode_write_cnt()) stays meaningful: an image parsed
+   before the file was last written is stale and is dropped.
+   Removing the file drops its image at once, through
+   process_forget_image(), so that the cache does not keep a
+   removed file's blocks allocated.
+
+   exec_images_lock is never held while acquiring filesys_lock,
+   because file system code calls process_forget_image() with
+   filesys_lock held.  Images are therefore parsed, and their
+   inodes closed, outside exec_images_lock. */
+
+/* Most images kept in the cache. */
+#define EXEC_CACHE_SIZE 16
+
+/* A validated loadable segment. */
+struct exec_segment
+  {
+    uint32_t file_page;         /* File offset of first page. */
+    uint32_t mem_page;          /* User virtual address of first page. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero following them. */
+    bool writable;              /* Writable by the process? */
+  };
+
+/* A parsed executable. */
+struct exec_image
+  {
+    struct list_elem elem;      /* exec_images element. */
+    struct inode *inode;        /* Executable, held open. */
+    unsigned write_cnt;         /* INODE's write count when parsed. */
+    int ref_cnt;                /* References, including the cache's. */
+    void (*entry) (void);       /* Entry point. */
+    int seg_cnt;                /* Number of segments. */
+    struct exec_segment segs[]; /* Loadable segments. */
+  };
+
+/* Cached images, most recently used first. */
+static struct list exec_images;
+static struct lock exec_images_lock;
+static struct lock_profile exec_images_lock_profile;
+
+/* Parses the executable open as FILE.  Returns a new image with
+   a reference count of 1, or a null pointer if FILE is not a
+   valid executable or memory is short. */
+static struct exec_image *
+image_parse (struct file *file)
 {
-  struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
-  struct file *file = NULL;
+  struct exec_image *img;
   off_t file_ofs;
-  bool success = false;
   int i;
-  /* Allocate and activate page directory. */
-  t->pagedir = pagedir_create ();
-  if (t->pagedir == NULL) 
-    goto done;
-  process_activate ();
-
-  /* Open executable file. */
-  file = filesys_open (file_name);
-  if (file == NULL) 
-    {
-      printf ("load: %s: open failed\n", file_name);
-      goto done; 
-    }
-
-  t->current_executable = file;
 
   /* Read and verify executable header. */
-  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
+  if (file_read_at (file, &ehdr, sizeof ehdr, 0) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
       || ehdr.e_machine != 3
       || ehdr.e_version != 1
       || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
       || ehdr.e_phnum > 1024) 
-    {
-      printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
-    }
+    return NULL;
+
+  img = malloc (sizeof *img + ehdr.e_phnum * sizeof *img->segs);
+  if (img == NULL)
+    return NULL;
+  img->seg_cnt = 0;
+  img->entry = (void (*) (void)) ehdr.e_entry;
 
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++) 
     {
       struct Elf32_Phdr phdr;
+      struct exec_segment *seg;
+      uint32_t page_offset;
 
-      if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
-      file_seek (file, file_ofs);
-
-      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+      if (file_ofs < 0 || file_ofs > file_length (file)
+          || file_read_at (file, &phdr, sizeof phdr, file_ofs) != sizeof phdr)
+        goto fail;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -445,53 +510,261 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          goto fail;
         case PT_LOAD:
-          if (validate_segment (&phdr, file)) 
+          if (!validate_segment (&phdr, file))
+            goto fail;
+          seg = &img->segs[img->seg_cnt++];
+          seg->writable = (phdr.p_flags & PF_W) != 0;
+          seg->file_page = phdr.p_offset & ~PGMASK;
+          seg->mem_page = phdr.p_vaddr & ~PGMASK;
+          page_offset = phdr.p_vaddr & PGMASK;
+          if (phdr.p_filesz > 0)
+            {
+              /* Normal segment.
+                 Read initial part from disk and zero the rest. */
+              seg->read_bytes = page_offset + phdr.p_filesz;
+              seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                                 - seg->read_bytes);
+            }
+          else 
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-              uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
-              if (phdr.p_filesz > 0)
-                {
-                  /* Normal segment.
-                     Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
-                }
-              else 
-                {
-                  /* Entirely zero.
-                     Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-                }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
+              /* Entirely zero.
+                 Don't read anything from disk. */
+              seg->read_bytes = 0;
+              seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
             }
-          else
-            goto done;
           break;
         }
     }
 
+  img->inode = inode_reopen (file_get_inode (file));
+  img->write_cnt = inode_write_cnt (img->inode);
+  img->ref_cnt = 1;
+  return img;
+
+ fail:
+  free (img);
+  return NULL;
+}
+
+/* Frees IMG, which must be out of the cache and unused. */
+static void
+image_free (struct exec_image *img)
+{
+  lock_acquire (&filesys_lock);
+  inode_close (img->inode);
+  lock_release (&filesys_lock);
+  free (img);
+}
+
+/* Removes IMG from the cache and drops the cache's reference to
+   it.  If that was the last reference, adds IMG to DEAD, to be
+   freed with image_free() once exec_images_lock is released.
+   exec_images_lock must be held. */
+static void
+image_evict (struct exec_image *img, struct list *dead)
+{
+  list_remove (&img->elem);
+  ASSERT (img->ref_cnt > 0);
+  if (--img->ref_cnt == 0)
+    list_push_back (dead, &img->elem);
+}
+
+/* Frees each image in DEAD. */
+static void
+image_free_all (struct list *dead)
+{
+  while (!list_empty (dead))
+    image_free (list_entry (list_pop_front (dead),
+                            struct exec_image, elem));
+}
+
+/* Drops images of files that have been written or removed since
+   they were parsed, adding them to DEAD as image_evict() does.
+   Returns the cached image of INODE, if any, or a null pointer.
+   exec_images_lock must be held. */
+static struct exec_image *
+image_lookup (struct inode *inode, struct list *dead)
+{
+  struct exec_image *img = NULL;
+  struct list_elem *e, *next;
+
+  for (e = list_begin (&exec_images); e != list_end (&exec_images); e = next)
+    {
+      struct exec_image *cand = list_entry (e, struct exec_image, elem);
+      next = list_next (e);
+
+      if (inode_is_removed (cand->inode)
+          || cand->write_cnt != inode_write_cnt (cand->inode))
+        image_evict (cand, dead);
+      else if (cand->inode == inode)
+        img = cand;
+    }
+  return img;
+}
+
+/* Returns the parsed image of the executable open as FILE, from
+   the cache if possible, or a null pointer if FILE is not a valid
+   executable.  Release it with image_put(). */
+static struct exec_image *
+image_get (struct file *file)
+{
+  struct inode *inode = file_get_inode (file);
+  struct exec_image *img, *parsed = NULL;
+  struct list dead;
+
+  list_init (&dead);
+  lock_acquire (&exec_images_lock);
+  img = image_lookup (inode, &dead);
+  if (img == NULL)
+    {
+      /* Miss: parse without exec_images_lock, so that execs of
+         other programs need not wait for our disk reads. */
+      lock_release (&exec_images_lock);
+      lock_acquire (&filesys_lock);
+      parsed = image_parse (file);
+      lock_release (&filesys_lock);
+      if (parsed == NULL)
+        {
+          image_free_all (&dead);
+          return NULL;
+        }
+
+      /* Another thread may have cached the same image meanwhile.
+         If so, use its copy and discard ours. */
+      lock_acquire (&exec_images_lock);
+      img = image_lookup (inode, &dead);
+      if (img == NULL)
+        {
+          img = parsed;
+          parsed = NULL;
+          if (list_size (&exec_images) >= EXEC_CACHE_SIZE)
+            image_evict (list_entry (list_back (&exec_images),
+                                     struct exec_image, elem), &dead);
+          list_push_front (&exec_images, &img->elem);
+        }
+    }
+
+  /* Move to the front and take a reference for the caller. */
+  list_remove (&img->elem);
+  list_push_front (&exec_images, &img->elem);
+  img->ref_cnt++;
+  lock_release (&exec_images_lock);
+
+  if (parsed != NULL)
+    image_free (parsed);
+  image_free_all (&dead);
+  return img;
+}
+
+/* Releases IMG, obtained from image_get(). */
+static void
+image_put (struct exec_image *img)
+{
+  bool last;
+
+  lock_acquire (&exec_images_lock);
+  ASSERT (img->ref_cnt > 0);
+  last = --img->ref_cnt == 0;
+  lock_release (&exec_images_lock);
+
+  if (last)
+    image_free (img);
+}
+
+/* Drops the cached image of INODE, if any, which is being removed
+   from the file system.  Called by filesys_remove(), so the
+   caller holds filesys_lock if any process may be running. */
+void
+process_forget_image (struct inode *inode)
+{
+  struct exec_image *img = NULL;
+  struct list_elem *e;
+
+  lock_acquire (&exec_images_lock);
+  for (e = list_begin (&exec_images); e != list_end (&exec_images);
+       e = list_next (e))
+    {
+      struct exec_image *cand = list_entry (e, struct exec_image, elem);
+      if (cand->inode == inode)
+        {
+          list_remove (e);
+          if (--cand->ref_cnt == 0)
+            img = cand;
+          break;
+        }
+    }
+  lock_release (&exec_images_lock);
+
+  /* filesys_lock is already held, so close the inode directly. */
+  if (img != NULL)
+    {
+      inode_close (img->inode);
+      free (img);
+    }
+}
+
+/* Initializes the executable image cache. */
+void
+process_init (void)
+{
+  list_init (&exec_images);
+  lock_init (&exec_images_lock);
+  lock_profile (&exec_images_lock, &exec_images_lock_profile, "exec_images");
+}
+
+/* Loads the ELF executable open as FILE into the current thread,
+   which takes ownership of FILE.  Stores the executable's entry
+   point into *EIP and its initial stack pointer into *ESP.
+   Returns true if successful, false otherwise. */
+bool
+load (struct file *file, void (**eip) (void), void **esp) 
+{
+  struct thread *t = thread_current ();
+  struct exec_image *img = NULL;
+  bool success = false;
+  int i;
+
+  t->current_executable = file;
+
+  /* Allocate and activate page directory. */
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL) 
+    goto done;
+  process_activate ();
+  if (!page_init ())
+    goto done;
+
+  img = image_get (file);
+  if (img == NULL)
+    {
+      printf ("load: %s: error loading executable\n", t->name);
+      goto done; 
+    }
+
+  /* Map the segments, to be read in on demand. */
+  for (i = 0; i < img->seg_cnt; i++)
+    {
+      const struct exec_segment *seg = &img->segs[i];
+      if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+                         seg->read_bytes, seg->zero_bytes, seg->writable))
+        goto done;
+    }
+
   /* Set up stack. */
   if (!setup_stack (esp))
     goto done;
-  
 
   /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+  *eip = img->entry;
 
   success = true;
  done:
   /* We arrive here whether the load is successful or not. */
-  if(file != NULL)
-    file_deny_write(file);
+  if (img != NULL)
+    image_put (img);
+  file_deny_write (file);
   return success;
 }
 
@@ -554,35 +827,40 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   The segment is only recorded as an area of the address space;
+   each page is read in when it is first touched.
+
    Return true if successful, false if a memory allocation error
-   or disk read error occurs. */
+   occurs or the segment overlaps an earlier one. */
 static bool
 load_segment (struct file *file, off_t ofs, uint8_t *upage,
               uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
 {
+  struct vma *prev;
+
   ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
-  file_seek (file, ofs);
-  int new_ofs = ofs;
-  while (read_bytes > 0 || zero_bytes > 0) 
+
+  /* Adjacent segments may share the page at their boundary.  The
+     later segment maps that page, which it reads from the file
+     in full, so the earlier segment gives it up. */
+  prev = vma_find (upage);
+  if (prev != NULL && prev->end == upage + PGSIZE) 
     {
-      /* Do calculate how to fill this page.
-         We will read PAGE_READ_BYTES bytes from FILE
-         and zero the final PAGE_ZERO_BYTES bytes. */
-      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-      size_t page_zero_bytes = PGSIZE - page_read_bytes;
-      struct sup_page_table_entry *spte = allocate_page(upage);
-      if(!lazy_load(file, new_ofs, upage, page_read_bytes, page_zero_bytes, writable, spte))
-        return false;
-      new_ofs += PGSIZE;
-      
-      /* Advance. */
-      read_bytes -= page_read_bytes;
-      zero_bytes -= page_zero_bytes;
-      upage += PGSIZE;
+      writable = writable || prev->writable;
+      if (prev->start == upage)
+        vma_remove (prev);
+      else 
+        {
+          prev->end = upage;
+          if (prev->read_bytes > (size_t) (upage - prev->start))
+            prev->read_bytes = upage - prev->start;
+        }
     }
-  return true;
+
+  return vma_add (upage, read_bytes + zero_bytes, file, ofs, read_bytes,
+                  writable) != NULL;
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
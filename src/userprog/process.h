@@ -4,6 +4,7 @@
 #include "threads/thread.h"
 #include "vm/page.h"
 
+void process_init (void);
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
@@ -11,4 +12,7 @@ void process_activate (void);
 bool install_page (void *upage, void *kpage, bool writable);
 bool lazy_load_page (struct sup_page_table_entry *spte);
 
+struct inode;
+void process_forget_image (struct inode *);
+
 #endif /* userprog/process.h */
@@ -2,11 +2,67 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <syscall-nr.h>
+#include <limits.h>
 #include <list.h>
+#include <round.h>
 #include <string.h>
+#include <uio.h>
+#include <cpuid.h>
+#include "threads/cpu.h"
+#include "threads/latency.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/trace.h"
+#include "userprog/gdt.h"
+#include "userprog/ioring.h"
+#include "userprog/pagedir.h"
+#include "userprog/tss.h"
+#include "vm/vma.h"
 
 static void syscall_handler (struct intr_frame *);
+static void syscall_latency_init (void);
 struct lock filesys_lock;
+static struct lock_profile filesys_lock_profile;
+static struct slab_cache *mmap_header_cache;
+
+/* Most user pages pinned at once by read() and write(). */
+#define RW_BATCH_PAGES 16
+
+/* Most histograms returned by one latency() call. */
+#define LATENCY_READ_MAX 64
+
+/* Most arguments taken by any system call. */
+#define SYSCALL_MAX_ARGS 4
+
+/* Bit in struct syscall's PTR_ARGS for argument N. */
+#define PTR_ARG(N) (1u << (N))
+
+/* A system call handler.  ARGS holds the call's arguments, already
+   copied in from the user stack.  Returns the value for EAX. */
+typedef uint32_t syscall_func (const uint32_t *args);
+
+/* Describes one system call. */
+struct syscall {
+    syscall_func *func;         /* Handler. */
+    int arg_cnt;                /* Number of arguments. */
+    unsigned ptr_args;          /* PTR_ARG() bits of user pointer arguments. */
+    const char *name;           /* Name, for latency statistics. */
+};
+
+/* True if the CPU supports sysenter and it has been set up. */
+bool syscall_sysenter;
+
+/* In syscall-entry.S. */
+void syscall_sysenter_entry (void);
+bool copy_user (void *dst, const void *src, size_t size);
+
+/* Returns true if the SIZE bytes at user address UADDR lie
+   entirely below PHYS_BASE. */
+static bool user_range_ok(const void *uaddr, size_t size){
+    uintptr_t start = (uintptr_t)uaddr;
+    return start + size >= start && start + size <= (uintptr_t)PHYS_BASE;
+}
 
 void exit (int status);
 int exec(const char *cmd_line);
@@ -27,138 +83,362 @@ bool mkdir(const char *dir);
 bool readdir(int fd, char *name);
 bool isdir(int fd);
 int inumber(int fd);
+int lockstat(struct lockstat *stats, int max_cnt);
+int latency(struct latency_hist *hists, int max_cnt);
+int getrusage(int who, struct rusage *usage);
+int pread(int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset);
+int readv(int fd, const struct iovec *iov, int iov_cnt);
+int writev(int fd, const struct iovec *iov, int iov_cnt);
+int fdlimit(int limit);
 
 void
 syscall_init (void) 
 {
   lock_init(&filesys_lock);
+  lock_profile(&filesys_lock, &filesys_lock_profile, "filesys");
+  mmap_header_cache = slab_cache_create("mmap_header", sizeof(struct mmap_header), NULL);
+  if(mmap_header_cache == NULL)
+    PANIC("syscall_init: can't create mmap_header cache");
+  syscall_latency_init();
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+
+  /* Also accept system calls through sysenter, which avoids the
+     interrupt gate and iret.  The entry stub uses the same
+     handler.  IA32_SYSENTER_ESP follows the running thread's
+     kernel stack; see tss_update(). */
+  if(cpu_has_sysenter()){
+    wrmsr(MSR_SYSENTER_CS, SEL_KCSEG);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)syscall_sysenter_entry);
+    syscall_sysenter = true;
+    tss_update();
+  }
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns false if any part of USRC is not valid user
+   memory; a bad address is caught by copy_user()'s page fault
+   fixup instead of killing the process from inside the kernel. */
+bool copy_from_user(void *dst, const void *usrc, size_t size){
+    if(!user_range_ok(usrc, size))
+        return false;
+    return copy_user(dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns false if any part of UDST is not valid user
+   memory. */
+bool copy_to_user(void *udst, const void *src, size_t size){
+    if(!user_range_ok(udst, size))
+        return false;
+    return copy_user(udst, src, size);
+}
+
+/* Most bytes strncpy_from_user() copies at a time. */
+#define STRNCPY_CHUNK 64
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  Returns the string's
+   length, SIZE if it does not fit, or -1 if USRC is not valid
+   user memory.  Each piece is copied with copy_user() and lies
+   within one page, which is readable either as a whole or not at
+   all, so reading past the terminator cannot fault. */
+int strncpy_from_user(char *dst, const char *usrc, size_t size){
+    size_t len = 0;
+
+    while(len < size){
+        const char *u = usrc + len;
+        size_t n = size - len;
+        char *nul;
+
+        if(n > PGSIZE - pg_ofs(u))
+            n = PGSIZE - pg_ofs(u);
+        if(n > STRNCPY_CHUNK)
+            n = STRNCPY_CHUNK;
+        if(!copy_from_user(dst + len, u, n))
+            return -1;
+        nul = memchr(dst + len, '\0', n);
+        if(nul != NULL)
+            return nul - dst;
+        len += n;
+    }
+    return size;
+}
+
+/* Copies the path or command line at user address UPATH into a
+   new page, which the caller must free with palloc_free_page().
+   Returns NULL if it is longer than a page or no page is free;
+   kills the process if UPATH is not valid user memory. */
+static char *path_from_user(const char *upath){
+    char *path = palloc_get_page(0);
+    int len;
+
+    if(path == NULL)
+        return NULL;
+    len = strncpy_from_user(path, upath, PGSIZE);
+    if(len < 0){
+        palloc_free_page(path);
+        exit(-1);
+    }
+    if(len == PGSIZE){
+        palloc_free_page(path);
+        return NULL;
+    }
+    return path;
+}
+
+static uint32_t sys_halt(const uint32_t *args UNUSED){
+    power_off();
+    NOT_REACHED();
+}
+
+static uint32_t sys_exit(const uint32_t *args){
+    exit((int)args[0]);
+    NOT_REACHED();
+}
+
+static uint32_t sys_exec(const uint32_t *args){
+    char *cmd_line = path_from_user((const char *)args[0]);
+    int pid;
+
+    if(cmd_line == NULL)
+        return -1;
+    pid = exec(cmd_line);
+    palloc_free_page(cmd_line);
+    return pid;
+}
+
+static uint32_t sys_wait(const uint32_t *args){
+    return wait((int)args[0]);
+}
+
+static uint32_t sys_create(const uint32_t *args){
+    char *file = path_from_user((const char *)args[0]);
+    bool success;
+
+    if(file == NULL)
+        return false;
+    success = create(file, (unsigned)args[1]);
+    palloc_free_page(file);
+    return success;
+}
+
+static uint32_t sys_remove(const uint32_t *args){
+    char *file = path_from_user((const char *)args[0]);
+    bool success;
+
+    if(file == NULL)
+        return false;
+    success = remove(file);
+    palloc_free_page(file);
+    return success;
+}
+
+static uint32_t sys_open(const uint32_t *args){
+    char *file = path_from_user((const char *)args[0]);
+    int fd;
+
+    if(file == NULL)
+        return -1;
+    fd = open(file);
+    palloc_free_page(file);
+    return fd;
+}
+
+static uint32_t sys_filesize(const uint32_t *args){
+    return filesize((int)args[0]);
+}
+
+static uint32_t sys_read(const uint32_t *args){
+    return read((int)args[0], (void *)args[1], (unsigned)args[2]);
+}
+
+static uint32_t sys_write(const uint32_t *args){
+    return write((int)args[0], (const void *)args[1], (unsigned)args[2]);
+}
+
+static uint32_t sys_seek(const uint32_t *args){
+    seek((int)args[0], (unsigned)args[1]);
+    return 0;
 }
 
+static uint32_t sys_tell(const uint32_t *args){
+    return tell((int)args[0]);
+}
+
+static uint32_t sys_close(const uint32_t *args){
+    close((int)args[0]);
+    return 0;
+}
+
+static uint32_t sys_mmap(const uint32_t *args){
+    return mmap((int)args[0], (void *)args[1]);
+}
+
+static uint32_t sys_munmap(const uint32_t *args){
+    munmap((mapid_t)args[0]);
+    return 0;
+}
+
+static uint32_t sys_chdir(const uint32_t *args){
+    char *dir = path_from_user((const char *)args[0]);
+    bool success;
+
+    if(dir == NULL)
+        return false;
+    success = chdir(dir);
+    palloc_free_page(dir);
+    return success;
+}
+
+static uint32_t sys_mkdir(const uint32_t *args){
+    char *dir = path_from_user((const char *)args[0]);
+    bool success;
+
+    if(dir == NULL)
+        return false;
+    success = mkdir(dir);
+    palloc_free_page(dir);
+    return success;
+}
+
+static uint32_t sys_readdir(const uint32_t *args){
+    return readdir((int)args[0], (char *)args[1]);
+}
+
+static uint32_t sys_isdir(const uint32_t *args){
+    return isdir((int)args[0]);
+}
+
+static uint32_t sys_inumber(const uint32_t *args){
+    return inumber((int)args[0]);
+}
+
+static uint32_t sys_lockstat(const uint32_t *args){
+    return lockstat((struct lockstat *)args[0], (int)args[1]);
+}
+
+static uint32_t sys_pread(const uint32_t *args){
+    return pread((int)args[0], (void *)args[1], (unsigned)args[2], (unsigned)args[3]);
+}
+
+static uint32_t sys_pwrite(const uint32_t *args){
+    return pwrite((int)args[0], (const void *)args[1], (unsigned)args[2], (unsigned)args[3]);
+}
+
+static uint32_t sys_readv(const uint32_t *args){
+    return readv((int)args[0], (const struct iovec *)args[1], (int)args[2]);
+}
+
+static uint32_t sys_writev(const uint32_t *args){
+    return writev((int)args[0], (const struct iovec *)args[1], (int)args[2]);
+}
+
+static uint32_t sys_ioring_setup(const uint32_t *args UNUSED){
+    return (uint32_t)ioring_setup();
+}
+
+static uint32_t sys_ioring_enter(const uint32_t *args){
+    return ioring_enter((unsigned)args[0], (unsigned)args[1]);
+}
+
+static uint32_t sys_fdlimit(const uint32_t *args){
+    return fdlimit((int)args[0]);
+}
+
+static uint32_t sys_latency(const uint32_t *args){
+    return latency((struct latency_hist *)args[0], (int)args[1]);
+}
+
+static uint32_t sys_getrusage(const uint32_t *args){
+    return getrusage((int)args[0], (struct rusage *)args[1]);
+}
+
+/* System call table, indexed by system call number.  Each entry
+   gives the handler, the number of arguments to copy in from the
+   user stack, which arguments are user pointers that must lie
+   below PHYS_BASE, and the call's name. */
+static const struct syscall syscall_table[] = {
+    [SYS_HALT]         = {sys_halt,         0, 0,          "halt"},
+    [SYS_EXIT]         = {sys_exit,         1, 0,          "exit"},
+    [SYS_EXEC]         = {sys_exec,         1, PTR_ARG(0), "exec"},
+    [SYS_WAIT]         = {sys_wait,         1, 0,          "wait"},
+    [SYS_CREATE]       = {sys_create,       2, PTR_ARG(0), "create"},
+    [SYS_REMOVE]       = {sys_remove,       1, PTR_ARG(0), "remove"},
+    [SYS_OPEN]         = {sys_open,         1, PTR_ARG(0), "open"},
+    [SYS_FILESIZE]     = {sys_filesize,     1, 0,          "filesize"},
+    [SYS_READ]         = {sys_read,         3, PTR_ARG(1), "read"},
+    [SYS_WRITE]        = {sys_write,        3, PTR_ARG(1), "write"},
+    [SYS_SEEK]         = {sys_seek,         2, 0,          "seek"},
+    [SYS_TELL]         = {sys_tell,         1, 0,          "tell"},
+    [SYS_CLOSE]        = {sys_close,        1, 0,          "close"},
+    [SYS_MMAP]         = {sys_mmap,         2, PTR_ARG(1), "mmap"},
+    [SYS_MUNMAP]       = {sys_munmap,       1, 0,          "munmap"},
+    [SYS_CHDIR]        = {sys_chdir,        1, PTR_ARG(0), "chdir"},
+    [SYS_MKDIR]        = {sys_mkdir,        1, PTR_ARG(0), "mkdir"},
+    [SYS_READDIR]      = {sys_readdir,      2, PTR_ARG(1), "readdir"},
+    [SYS_ISDIR]        = {sys_isdir,        1, 0,          "isdir"},
+    [SYS_INUMBER]      = {sys_inumber,      1, 0,          "inumber"},
+    [SYS_LOCKSTAT]     = {sys_lockstat,     2, PTR_ARG(0), "lockstat"},
+    [SYS_PREAD]        = {sys_pread,        4, PTR_ARG(1), "pread"},
+    [SYS_PWRITE]       = {sys_pwrite,       4, PTR_ARG(1), "pwrite"},
+    [SYS_READV]        = {sys_readv,        3, PTR_ARG(1), "readv"},
+    [SYS_WRITEV]       = {sys_writev,       3, PTR_ARG(1), "writev"},
+    [SYS_IORING_SETUP] = {sys_ioring_setup, 0, 0,          "ioring_setup"},
+    [SYS_IORING_ENTER] = {sys_ioring_enter, 2, 0,          "ioring_enter"},
+    [SYS_FDLIMIT]      = {sys_fdlimit,      1, 0,          "fdlimit"},
+    [SYS_LATENCY]      = {sys_latency,      2, PTR_ARG(0), "latency"},
+    [SYS_GETRUSAGE]    = {sys_getrusage,    2, PTR_ARG(1), "getrusage"},
+};
+
+/* Dispatch latency of each system call, indexed by number. */
+static struct latency_profile syscall_latency[sizeof syscall_table
+                                              / sizeof *syscall_table];
+
+/* Registers a latency profile for each system call. */
+static void syscall_latency_init(void){
+    size_t i;
+
+    for(i = 0; i < sizeof syscall_table / sizeof *syscall_table; i++)
+        if(syscall_table[i].func != NULL)
+            latency_profile(&syscall_latency[i], syscall_table[i].name);
+}
+
+/* Reached through int $0x30 or, where the CPU supports it,
+   through sysenter (see syscall-entry.S); both build the same
+   intr_frame. */
 static void
 syscall_handler (struct intr_frame *f) 
 {   
-  thread_current()->esp = f->esp;
-  switch(syscall_num(f)){
-  	case SYS_HALT  		:
-		power_off();
-		break;
-    case SYS_EXIT  		:
-    	if(is_kernel_vaddr(f->esp + 4))
-    		exit(-1);
-    	exit(first_arg(f)); // status
-    	break;
-    case SYS_EXEC  		:
-        if(is_kernel_vaddr(f->esp + 4) ||
-           is_kernel_vaddr((void *)first_arg(f)))
-            exit(-1);
-    	f->eax = exec((const char *)first_arg(f));
-    	break;
-    case SYS_WAIT  		:
-        if(is_kernel_vaddr(f->esp + 4))
-            exit(-1);
-        f->eax = wait((int)first_arg(f));
-    	break;
-    case SYS_CREATE		:
-    	if(is_kernel_vaddr(f->esp + 4) || 
-    	   is_kernel_vaddr(f->esp + 8) ||
-    	   is_kernel_vaddr((void *)first_arg(f)))
-    		exit(-1);
-    	f->eax = create((const char *)first_arg(f),(unsigned)second_arg(f));
-    	break;
-    case SYS_REMOVE		:
-    	if(is_kernel_vaddr(f->esp + 4) || 
-    	   is_kernel_vaddr((void *)first_arg(f)))
-    		exit(-1);
-    	f->eax = remove((const char *)first_arg(f));
-    	break;
-    case SYS_OPEN  		:
-    	if(is_kernel_vaddr(f->esp + 4)||
-    	   is_kernel_vaddr((void *)first_arg(f)))
-    		exit(-1);
-    	f->eax = open((const char *)first_arg(f));
-    	break;
-    case SYS_FILESIZE 	:
-        if(is_kernel_vaddr(f->esp + 4))
-    		exit(-1);
-    	f->eax = filesize((int)first_arg(f));
-    	break;
-    case SYS_READ  		:
-    	if(is_kernel_vaddr(f->esp + 4) || 
-    	   is_kernel_vaddr(f->esp + 8) ||
-    	   is_kernel_vaddr(f->esp + 12)||
-    	   is_kernel_vaddr((void *)second_arg(f)))
-    		exit(-1);
-    	f->eax = read((int)first_arg(f),(void *)second_arg(f),(unsigned)third_arg(f));
-    	break;      
-    case SYS_WRITE 		:
-    	if(is_kernel_vaddr(f->esp + 4) || 
-    	   is_kernel_vaddr(f->esp + 8) ||
-    	   is_kernel_vaddr(f->esp + 12)||
-    	   is_kernel_vaddr((void *)second_arg(f)))
-    		exit(-1);
-    	f->eax = write((int)first_arg(f),(void *)second_arg(f),(unsigned)third_arg(f));
-    	break;  
-    case SYS_SEEK  		:
-    	if(is_kernel_vaddr(f->esp + 4) || 
-    	   is_kernel_vaddr(f->esp + 8))
-    		exit(-1);
-    	seek((int)first_arg(f),(unsigned)second_arg(f));
-    	break;                   
-    case SYS_TELL  		:
-   		if(is_kernel_vaddr(f->esp + 4))
-    		exit(-1);
-    	f->eax = tell((int)first_arg(f));
-    	break;	               
-    case SYS_CLOSE 		:
-    	if(is_kernel_vaddr(f->esp + 4))
-    		exit(-1);
-    	close((int)first_arg(f));
-    	break;     
-    case SYS_MMAP           :
-        if(is_kernel_vaddr(f->esp + 4) ||
-           is_kernel_vaddr(f->esp + 8) ||
-           is_kernel_vaddr((void *) second_arg(f)))
-           exit(-1); 
-        f->eax = mmap((int)first_arg(f), (void *)second_arg(f));
-        break;
-    case SYS_MUNMAP         :
-        if(is_kernel_vaddr(f->esp + 4))
-            exit(-1);
-        munmap((mapid_t)first_arg(f));
-        break;
-    case SYS_CHDIR      :
-        if(is_kernel_vaddr(f->esp + 4)||
-           is_kernel_vaddr((void *)first_arg(f)))
-            exit(-1);
-        f->eax = chdir((char *)first_arg(f));
-        break;
-    case SYS_MKDIR      :
-        if(is_kernel_vaddr(f->esp + 4)||
-           is_kernel_vaddr((void *)first_arg(f)))
-            exit(-1);
-        f->eax = mkdir((char *)first_arg(f));
-        break;
-    case SYS_READDIR    :
-        if(is_kernel_vaddr(f->esp + 4) || 
-           is_kernel_vaddr(f->esp + 8) ||
-           is_kernel_vaddr((void *)second_arg(f)))
-            exit(-1);
-        f->eax = readdir((int)first_arg(f), (char *)second_arg(f));
-        break;
-    case SYS_ISDIR      :
-        if(is_kernel_vaddr(f->esp + 4))
-            exit(-1);
-        f->eax = isdir((int)first_arg(f));
-        break;
-    case SYS_INUMBER    :
-        if(is_kernel_vaddr(f->esp + 4))
+    uint32_t args[SYSCALL_MAX_ARGS];
+    const struct syscall *sc;
+    uint32_t number;
+    uint64_t start;
+    int i;
+
+    thread_current()->esp = f->esp;
+    if(!copy_from_user(&number, f->esp, sizeof number))
+        exit(-1);
+    if(number >= sizeof syscall_table / sizeof *syscall_table ||
+       syscall_table[number].func == NULL){
+        printf("unknown system call! \n");
+        return;
+    }
+
+    /* Fetch all the arguments with one copy, then check the
+       pointer arguments. */
+    sc = &syscall_table[number];
+    if(!copy_from_user(args, (uint32_t *)f->esp + 1, sc->arg_cnt * sizeof *args))
+        exit(-1);
+    for(i = 0; i < sc->arg_cnt; i++)
+        if((sc->ptr_args & PTR_ARG(i)) && is_kernel_vaddr((void *)args[i]))
             exit(-1);
-        f->eax = inumber((int)first_arg(f));
-        break;
-    default				:
-    	printf("unknown system call! \n");   
-  }
+
+    trace_event(TRACE_SYSCALL, number, sc->arg_cnt > 0 ? args[0] : 0);
+    start = rdtsc();
+    f->eax = sc->func(args);
+    latency_record(&syscall_latency[number], start);
+    trace_event(TRACE_SYSRET, number, f->eax);
 }
 
 void exit(int status){
@@ -203,134 +483,211 @@ int open(const char *file){
         lock_release(&filesys_lock);
         return -1;
     }
-    int i;
-    for(i = 0; i < 128; i++){
-        if(thread_current()->fd[i] == NULL){
-            thread_current()->fd[i] = opened_file;
-            if(inode_isdir(opened_file->inode))
-                thread_current()->fd[i]->dir = dir_open(inode_reopen(opened_file->inode));
-            lock_release(&filesys_lock);
-            return i+3;
-        }
-    }
+    int fd = fd_install(&thread_current()->fds, opened_file);
+    if(fd < 0)
+        file_close(opened_file);
+    else if(inode_isdir(opened_file->inode))
+        opened_file->dir = dir_open(inode_reopen(opened_file->inode));
     lock_release(&filesys_lock);
-    return -1;
+    return fd;
 }
 
 int filesize(int fd){
-    if(fd > 130 || fd < 3)
-        exit(-1);
-
-    if(thread_current()->fd[fd-3]==NULL)
+    struct file *file = fd_lookup(&thread_current()->fds, fd);
+    if(file == NULL)
         return -1;
 
     lock_acquire(&filesys_lock);
-    int len = file_length(thread_current()->fd[fd-3]);
+    int len = file_length(file);
     lock_release(&filesys_lock);
 
     return len;
 }
 
-int read(int fd, void *buffer, unsigned size){
-    if(fd > 130)
-        exit(-1);
-    else if(thread_current()->fd[fd-3] == NULL)
+/* Reads (if IS_READ) or writes between FILE, starting at byte
+   offset POS, and the IOV_CNT user buffers in IOV, filling or
+   draining each buffer in turn.  Pages are pinned at most
+   RW_BATCH_PAGES at a time, across buffers.  Each batch is
+   copied straight to or from its frames under a single
+   acquisition of filesys_lock and unpinned in one pass.  Returns
+   the number of bytes transferred; kills the process if a buffer
+   is not valid. */
+static int file_rw_user(struct file *file, const struct iovec *iov, int iov_cnt,
+                        off_t pos, bool is_read){
+    void *upages[RW_BATCH_PAGES];
+    uint8_t *uaddrs[RW_BATCH_PAGES];
+    size_t lens[RW_BATCH_PAGES];
+    struct frame_table_entry *ftes[RW_BATCH_PAGES];
+    int seg = 0;
+    size_t seg_ofs = 0;
+    int total = 0;
+    int i;
+
+    for(i = 0; i < iov_cnt; i++)
+        if(!user_range_ok(iov[i].iov_base, iov[i].iov_len))
+            exit(-1);
+
+    while(seg < iov_cnt){
+        size_t piece_cnt = 0;
+        size_t want = 0;
+        size_t done = 0;
+        size_t j;
+
+        /* Gather up to a batch of page-sized pieces. */
+        while(piece_cnt < RW_BATCH_PAGES && seg < iov_cnt){
+            uint8_t *u = (uint8_t *)iov[seg].iov_base + seg_ofs;
+            size_t n = iov[seg].iov_len - seg_ofs;
+
+            if(n == 0){
+                seg++;
+                seg_ofs = 0;
+                continue;
+            }
+            if(n > PGSIZE - pg_ofs(u))
+                n = PGSIZE - pg_ofs(u);
+            upages[piece_cnt] = pg_round_down(u);
+            uaddrs[piece_cnt] = u;
+            lens[piece_cnt] = n;
+            piece_cnt++;
+            want += n;
+            seg_ofs += n;
+        }
+        if(piece_cnt == 0)
+            break;
+
+        if(!frame_pin_user(upages, piece_cnt, is_read, ftes))
+            exit(-1);
+        lock_acquire(&filesys_lock);
+        for(j = 0; j < piece_cnt; j++){
+            uint8_t *kaddr = (uint8_t *)ftes[j]->kernel + pg_ofs(uaddrs[j]);
+            off_t len = is_read ? file_read_at(file, kaddr, lens[j], pos)
+                                : file_write_at(file, kaddr, lens[j], pos);
+            pos += len;
+            done += len;
+            if((size_t)len < lens[j])
+                break;
+        }
+        lock_release(&filesys_lock);
+        frame_unpin_user(ftes, piece_cnt, is_read);
+
+        total += done;
+        if(done < want)
+            break;
+    }
+    return total;
+}
+
+/* Returns the open file for FD, killing the process if FD is
+   not an open file. */
+static struct file *fd_file(int fd){
+    struct file *file = fd_lookup(&thread_current()->fds, fd);
+    if(file == NULL)
         exit(-1);
-    else if(fd == 0){
-        unsigned i;
-        for(i = 0; i < size; i++){
-            memset(buffer+i, input_getc(), 1);
+    return file;
+}
+
+/* Transfers between FD's file, at its current position, and the
+   IOV_CNT buffers in IOV, then advances the position. */
+static int fd_rw_user(int fd, const struct iovec *iov, int iov_cnt, bool is_read){
+    struct file *file = fd_file(fd);
+    off_t pos = file_tell(file);
+    int len;
+
+    len = file_rw_user(file, iov, iov_cnt, pos, is_read);
+    file_seek(file, pos + len);
+    return len;
+}
+
+int read(int fd, void *buffer, unsigned size){
+    if(fd == 0){
+        /* Take keys from the input buffer in chunks. */
+        uint8_t keys[64];
+        unsigned done, n;
+        for(done = 0; done < size; done += n){
+            n = size - done < sizeof keys ? size - done : sizeof keys;
+            input_read(keys, n);
+            if(!copy_to_user((uint8_t *)buffer + done, keys, n))
+                exit(-1);
         }
         return size;
     }
     else if(fd == 1 || fd ==2)
         exit(-1);
     else{
-        swap_prevention_buffer(buffer, size, true);
-        lock_acquire(&filesys_lock);
-        int len = file_read(thread_current()->fd[fd-3],buffer,size);
-        lock_release(&filesys_lock);
-        swap_prevention_buffer(buffer, size, false);
-        return len;
-    }   
+        struct iovec iov = {buffer, size};
+        return fd_rw_user(fd, &iov, 1, true);
+    }
 }
 
 int write(int fd, const void *buffer, unsigned size){
-    if(fd > 130)
-        exit(-1);
     if(buffer == NULL)
         exit(-1);
     if(fd == 1){ // console write
-        lock_acquire(&filesys_lock);    
-        putbuf(buffer, size);
-        lock_release(&filesys_lock);
+        /* Copy out in chunks, so that faults on BUFFER are taken
+           outside the console lock and nothing waits on the file
+           system lock. */
+        char chunk[256];
+        unsigned done, n;
+        for(done = 0; done < size; done += n){
+            n = size - done < sizeof chunk ? size - done : sizeof chunk;
+            if(!copy_from_user(chunk, (const char *)buffer + done, n))
+                exit(-1);
+            putbuf(chunk, n);
+        }
         return size;
     }
     else if (fd == 0){ //std input
         return -1;
     }
-    else if(thread_current()->fd[fd-3] == NULL){
-        exit(-1);
+    else if(!fd_file(fd)->deny_write){
+        struct iovec iov = {(void *)buffer, size};
+        return fd_rw_user(fd, &iov, 1, false);
     }
-    else{
-        if(!thread_current()->fd[fd-3]->deny_write){
-            swap_prevention_buffer(buffer, size, true);
-            lock_acquire(&filesys_lock);
-            int len = file_write(thread_current()->fd[fd-3], buffer, size);
-            lock_release(&filesys_lock);
-            swap_prevention_buffer(buffer, size, false);
-            return len;
-        }
-        lock_release(&filesys_lock);
+    else
         return 0;
-    }
 }
 
 void seek(int fd, unsigned position){
-    if(fd > 130)
-        exit(-1);
-    if(thread_current()->fd[fd-3] == NULL)
-        exit(-1);
+    struct file *file = fd_file(fd);
     lock_acquire(&filesys_lock);
-    file_seek(thread_current()->fd[fd-3],position);
+    file_seek(file, position);
     lock_release(&filesys_lock);
 }
 
 unsigned tell(int fd){
-    if(fd > 130)
-        exit(-1);
-    if(thread_current()->fd[fd-3] == NULL)
-        exit(-1);
+    struct file *file = fd_file(fd);
     lock_acquire(&filesys_lock);
-    unsigned pos = file_tell(thread_current()->fd[fd-3]);
+    unsigned pos = file_tell(file);
     lock_release(&filesys_lock);
     return pos;
 }
 
 void close(int fd){
-    if(fd > 130 || fd < 3)
-        exit(-1);
-    if(thread_current()->fd[fd-3] == NULL)
+    struct file *file = fd_remove(&thread_current()->fds, fd);
+    if(file == NULL)
         exit(-1);
     lock_acquire(&filesys_lock);
-    dir_close(thread_current()->fd[fd-3]->dir);
-    file_close(thread_current()->fd[fd-3]);
+    dir_close(file->dir);
+    file_close(file);
     lock_release(&filesys_lock);
-    thread_current()->fd[fd-3] = NULL;
 }
 
 mapid_t mmap(int fd, void *addr){
-    if(fd==0 || fd==1)
+    struct file *file = fd_lookup(&thread_current()->fds, fd);
+    if(file == NULL)
         return MAP_FAILED;
     if(addr == NULL)
         return MAP_FAILED;
     if(pg_ofs(addr))
         return MAP_FAILED;
     lock_acquire(&filesys_lock);
-    void *tmp;
     struct thread *t = thread_current();
-    struct mmap_header *mh = (struct mmap_header *)malloc(sizeof(struct mmap_header));
-    mh->file = file_reopen(t->fd[fd-3]);
+    struct mmap_header *mh = slab_alloc(mmap_header_cache);
+    if(mh == NULL){
+        lock_release(&filesys_lock);
+        return MAP_FAILED;
+    }
+    mh->file = file_reopen(file);
     if(mh->file == NULL){
         goto FAIL;
     }
@@ -339,20 +696,14 @@ mapid_t mmap(int fd, void *addr){
     if(filesize == 0)
         goto FAIL;
 
-    for(tmp = addr; tmp < addr + filesize; tmp += PGSIZE){
-        if(find_spte(tmp)){
-            goto FAIL;
-        }
-    }
+    /* Pages are read in as they are touched.  Stack pages have no
+       area, so check for their page table entries too. */
+    if(find_spte_range(addr, addr + filesize))
+        goto FAIL;
+    mh->vma = vma_add(addr, filesize, mh->file, 0, filesize, true);
+    if(mh->vma == NULL)
+        goto FAIL;
 
-    for(tmp = addr; tmp < addr + filesize; tmp += PGSIZE){
-        if(tmp == pg_round_down(addr+filesize))
-            lazy_load(mh->file,tmp-addr, tmp, filesize+addr-tmp,
-                      PGSIZE-(filesize+addr-tmp), true, allocate_page(tmp));
-        else
-            lazy_load(mh->file,tmp-addr,tmp, PGSIZE, 0, true, allocate_page(tmp));
-    }
-    
     mh->filesize = filesize;
     mh->user = addr;
     mh->mapid = (int)addr>>3;
@@ -362,7 +713,7 @@ mapid_t mmap(int fd, void *addr){
 
 FAIL:
     file_close(mh->file);
-    free(mh);
+    slab_free(mmap_header_cache, mh);
     lock_release(&filesys_lock);
     return MAP_FAILED;
 }
@@ -371,13 +722,17 @@ void munmap(mapid_t mapping){
     struct thread *t = thread_current();
     struct list_elem *e;
     struct list *mmap_list = &(t->mmap_list);
+    /* Ring requests may still have mapped pages pinned. */
+    ioring_quiesce();
     lock_acquire(&filesys_lock);
     for(e=list_begin(mmap_list);e!=list_end(mmap_list);e=list_next(e)){
         struct mmap_header *mh = list_entry(e, struct mmap_header, list_elem);
         if(mh->mapid == mapping){
-            void *tmp;
-            for(tmp = mh->user; tmp < mh->user + mh->filesize; tmp += PGSIZE){
-                struct sup_page_table_entry *spte = find_spte(tmp);
+            void *tmp, *end = mh->user + mh->filesize;
+            struct sup_page_table_entry *spte;
+            for(spte = find_spte_range(mh->user, end); spte != NULL;
+                spte = find_spte_range(tmp + PGSIZE, end)){
+                tmp = spte->user_vaddr;
                 if(spte->state == SPTE_LOAD){
                     deallocate_page(tmp);
                 }
@@ -399,9 +754,10 @@ void munmap(mapid_t mapping){
                     pagedir_clear_page(t->pagedir,tmp);
                 }
             }
+            vma_remove(mh->vma);
             list_remove(&mh->list_elem);
             file_close(mh->file);
-            free(mh);
+            slab_free(mmap_header_cache, mh);
             break;
         }
     }
@@ -430,20 +786,166 @@ bool chdir(const char *path){
 }
 
 bool readdir(int fd, char *name){
-    struct dir *dir = thread_current()->fd[fd-3]->dir;
+    struct dir *dir = fd_file(fd)->dir;
+    char buf[NAME_MAX + 1];
 
     do{
-        if(!dir_readdir(dir, name)){
+        if(!dir_readdir(dir, buf)){
             return false;
         }
-    } while(strcmp(name, ".") == 0 || strcmp(name, "..") == 0);
+    } while(strcmp(buf, ".") == 0 || strcmp(buf, "..") == 0);
+    if(!copy_to_user(name, buf, strlen(buf) + 1))
+        exit(-1);
     return true;
 }
 
 bool isdir(int fd){
-    return thread_current()->fd[fd-3]->inode->data.isdir;
+    return fd_file(fd)->inode->data.isdir;
 }
 
 int inumber(int fd){
-    return inode_get_inumber(thread_current()->fd[fd-3]->inode);
+    return inode_get_inumber(fd_file(fd)->inode);
+}
+
+int lockstat(struct lockstat *stats, int max_cnt){
+    struct lockstat *buf;
+    int cnt;
+
+    if(max_cnt <= 0)
+        return 0;
+    if(max_cnt > (int)(PGSIZE / sizeof *buf))
+        max_cnt = PGSIZE / sizeof *buf;
+    if(is_kernel_vaddr(stats + max_cnt))
+        exit(-1);
+
+    /* Snapshot into a kernel page first: lock_profile_read() runs
+       with interrupts off and must not fault on the user buffer. */
+    buf = palloc_get_page(0);
+    if(buf == NULL)
+        return -1;
+    cnt = lock_profile_read(buf, max_cnt);
+    if(!copy_to_user(stats, buf, cnt * sizeof *buf)){
+        palloc_free_page(buf);
+        exit(-1);
+    }
+    palloc_free_page(buf);
+    return cnt;
+}
+
+int latency(struct latency_hist *hists, int max_cnt){
+    struct latency_hist *buf;
+    int cnt;
+
+    if(max_cnt <= 0)
+        return 0;
+    if(max_cnt > LATENCY_READ_MAX)
+        max_cnt = LATENCY_READ_MAX;
+    if(is_kernel_vaddr(hists + max_cnt))
+        exit(-1);
+
+    /* Snapshot first, as lockstat() does. */
+    buf = malloc(max_cnt * sizeof *buf);
+    if(buf == NULL)
+        return -1;
+    cnt = latency_read(buf, max_cnt);
+    if(!copy_to_user(hists, buf, cnt * sizeof *buf)){
+        free(buf);
+        exit(-1);
+    }
+    free(buf);
+    return cnt;
+}
+
+int getrusage(int who, struct rusage *usage){
+    struct thread *t = thread_current();
+    struct rusage snapshot;
+    enum intr_level old_level;
+
+    if(who != RUSAGE_SELF && who != RUSAGE_CHILDREN)
+        return -1;
+
+    /* The timer interrupt updates the tick counts. */
+    old_level = intr_disable();
+    snapshot = who == RUSAGE_SELF ? t->usage : t->child_usage;
+    intr_set_level(old_level);
+
+    if(!copy_to_user(usage, &snapshot, sizeof snapshot))
+        exit(-1);
+    return 0;
+}
+
+/* Returns true if SIZE bytes at byte OFFSET lie within the
+   largest possible file, so that OFFSET fits in an off_t and the
+   inode never has to grow past what it can index. */
+static bool file_range_ok(unsigned size, unsigned offset){
+    return offset <= INT_MAX && offset + size >= offset
+           && offset + size <= INODE_MAX_LENGTH;
+}
+
+int pread(int fd, void *buffer, unsigned size, unsigned offset){
+    struct file *file = fd_file(fd);
+    struct iovec iov = {buffer, size};
+
+    if(!file_range_ok(size, offset))
+        return -1;
+    return file_rw_user(file, &iov, 1, offset, true);
+}
+
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset){
+    struct file *file = fd_file(fd);
+    struct iovec iov = {(void *)buffer, size};
+
+    if(!file_range_ok(size, offset))
+        return -1;
+    return file_rw_user(file, &iov, 1, offset, false);
+}
+
+/* Copies the IOV_CNT-element iovec array at user address UIOV
+   into IOV, which has room for IOV_MAX elements.  Returns false if
+   IOV_CNT is out of range; kills the process if UIOV is bad. */
+static bool copy_iov_in(struct iovec *iov, const struct iovec *uiov, int iov_cnt){
+    if(iov_cnt < 0 || iov_cnt > IOV_MAX)
+        return false;
+    if(!copy_from_user(iov, uiov, iov_cnt * sizeof *iov))
+        exit(-1);
+    return true;
+}
+
+int readv(int fd, const struct iovec *uiov, int iov_cnt){
+    struct iovec iov[IOV_MAX];
+
+    fd_file(fd);
+    if(!copy_iov_in(iov, uiov, iov_cnt))
+        return -1;
+    return fd_rw_user(fd, iov, iov_cnt, true);
+}
+
+int writev(int fd, const struct iovec *uiov, int iov_cnt){
+    struct iovec iov[IOV_MAX];
+    int total = 0;
+    int i;
+
+    if(!copy_iov_in(iov, uiov, iov_cnt))
+        return -1;
+    if(fd == 1){
+        /* Console: write each buffer in turn, as write() does. */
+        for(i = 0; i < iov_cnt; i++)
+            total += write(1, iov[i].iov_base, iov[i].iov_len);
+        return total;
+    }
+    fd_file(fd);
+    return fd_rw_user(fd, iov, iov_cnt, false);
+}
+
+/* Sets the most files the process may hold open to LIMIT, if
+   LIMIT is positive.  Children inherit the limit.  Returns the
+   limit before the call, or -1 if LIMIT is above FD_LIMIT_MAX or
+   below an open file descriptor. */
+int fdlimit(int limit){
+    struct fd_table *fds = &thread_current()->fds;
+    int old = fds->limit;
+
+    if(limit > 0 && !fd_set_limit(fds, limit))
+        return -1;
+    return old;
 }
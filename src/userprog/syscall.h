@@ -15,14 +15,18 @@
 #include "filesys/file.h"
 
 //typedef int pid_t;
-#define syscall_num(f) (*(uint32_t *)((f)->esp))
-#define first_arg(f) (*(uint32_t *)((f)->esp + 4))
-#define second_arg(f) (*(uint32_t *)((f)->esp + 8))
-#define third_arg(f) (*(uint32_t *)((f)->esp + 12))
 #define MAP_FAILED ((mapid_t)-1);
 
 typedef int mapid_t;
 void syscall_init (void);
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+extern bool syscall_sysenter;
+
+int open (const char *file);
+void close (int fd);
 
 extern struct lock filesys_lock;
 
@@ -32,6 +36,7 @@ struct mmap_header{
     void *user; 
     int filesize;
     mapid_t mapid;
+    struct vma *vma;                /* Area of the address space. */
 };
 
 #endif /* userprog/syscall.h */
@@ -2,6 +2,8 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -97,10 +99,13 @@ tss_get (void)
 }
 
 /* Sets the ring 0 stack pointer in the TSS to point to the end
-   of the thread stack. */
+   of the thread stack.  The sysenter stack pointer, if sysenter
+   is in use, must point to the same place. */
 void
 tss_update (void) 
 {
   ASSERT (tss != NULL);
   tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
+  if (syscall_sysenter)
+    wrmsr (MSR_SYSENTER_ESP, (uint32_t) tss->esp0);
 }
@@ -3,15 +3,22 @@
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "devices/timer.h"
+#include "threads/vaddr.h"
+#include "userprog/exception.h"
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
 #include "vm/page.h"
 #include "vm/swap.h"
+#include "vm/vma.h"
 
 struct hash frame_table;
 struct list frame_list;
 struct list_elem *eviction_ptr;
-struct lock frame_table_lock;
+struct mutex frame_table_lock;
+static struct lock_profile frame_table_lock_profile;
+static struct slab_cache *fte_cache;
 /*
  * Initialize frame table
  */
@@ -43,41 +50,48 @@ frame_init (void)
 	eviction_ptr = NULL;
 	list_init(&frame_list);
 	hash_init(&frame_table, frame_hash_function, frame_hash_less, NULL);
-	lock_init(&frame_table_lock);
+	mutex_init(&frame_table_lock);
+	lock_profile(&frame_table_lock.lock, &frame_table_lock_profile, "frame_table");
+	fte_cache = slab_cache_create("fte", sizeof(struct frame_table_entry), NULL);
+	if(fte_cache == NULL)
+		PANIC("frame_init: can't create fte cache");
 }
 
 /* 
- * Make a new frame table entry for addr.
+ * Make a new frame table entry for addr.  Returns NULL if no
+ * frame is free, or if addr has no supplemental page table entry
+ * and none can be allocated; find_spte() tells the two apart.
  */
 uint32_t *
 _allocate_frame (void *addr) // user virtual address
 {	
-	struct frame_table_entry *fte = malloc(sizeof(struct frame_table_entry));
+	struct sup_page_table_entry *spte = find_spte(addr);
+	struct frame_table_entry *fte;
+
+	if(spte == NULL){
+		spte = allocate_page(addr);
+		if(spte == NULL)
+			return NULL;
+		spte->writable = true;
+	}
+
+	fte = slab_alloc(fte_cache);
 	if(fte == NULL){
 		return NULL;
 	}
 	fte->swap_prevention = true;
+	fte->pin_cnt = 0;
 	fte->kernel = palloc_get_page(PAL_USER | PAL_ZERO);
 	if(fte->kernel == NULL){
-		free(fte);
+		slab_free(fte_cache, fte);
 		return NULL;
 	}
 	fte->user = addr;
 	fte->owner = thread_current();
+	fte->spte = spte;
 	list_push_front(&frame_list, &fte->list_elem);
 	hash_insert(&frame_table, &fte->hash_elem);
 
-	struct sup_page_table_entry spte;
-	spte.user_vaddr = addr;
-	struct hash_elem *e;
-	if((e = hash_find(thread_current()->sup_page_dir, &spte.hash_elem)) == NULL){
-		fte->spte = allocate_page(addr);
-    	fte->spte->writable = true;
-	}
-	else{
-		fte->spte = hash_entry(e, struct sup_page_table_entry, hash_elem);
-	}
-
 	bool spte_lazy_load = (fte->spte->state == SPTE_LOAD) ? true : false;
 
 	fte->spte->kpage = fte->kernel;
@@ -90,25 +104,27 @@ _allocate_frame (void *addr) // user virtual address
 
 uint32_t *
 allocate_frame (void *_addr){
-	bool l = lock_held_by_current_thread(&frame_table_lock);
+	bool l = mutex_held_by_current_thread(&frame_table_lock);
 	if(!l)
-		lock_acquire(&frame_table_lock);
+		mutex_acquire(&frame_table_lock);
 	void *addr = (void*)pg_round_down(_addr);
 	uint32_t *kernel;
 	while((kernel = _allocate_frame(addr)) == NULL) {
-		if(!swap_out()){
-			lock_release(&frame_table_lock);
+		/* Evicting a user page cannot make room for a page
+		   table entry. */
+		if(find_spte(addr) == NULL || !swap_out()){
+			mutex_release(&frame_table_lock);
 			exit(-1);
 		}
 	}
 	struct sup_page_table_entry *spte = find_spte(addr);
     if (!install_page (spte->user_vaddr, spte->kpage, spte->writable)) 
     {
-	  lock_release(&frame_table_lock);
+	  mutex_release(&frame_table_lock);
       exit(-1);         
     }
     if(!l)
-		lock_release(&frame_table_lock);
+		mutex_release(&frame_table_lock);
 	return kernel;
 }
 /*
@@ -120,7 +136,7 @@ void deallocate_frame(void *addr){
 	pagedir_clear_page(thread_current()->pagedir, addr);
 
 	palloc_free_page(fte->kernel);
-	free(fte);
+	slab_free(fte_cache, fte);
 }*/
 
 void deallocate_fte(struct frame_table_entry *fte){
@@ -129,7 +145,7 @@ void deallocate_fte(struct frame_table_entry *fte){
 	list_remove(&fte->list_elem);
 	pagedir_clear_page(fte->owner->pagedir, fte->user);
 	palloc_free_page(fte->kernel);
-	free(fte);
+	slab_free(fte_cache, fte);
 }
 
 void deallocate_frame_owned_by_thread(void){
@@ -143,7 +159,7 @@ void deallocate_frame_owned_by_thread(void){
     		e=list_prev(e);
     		eviction_ptr_push(&fte->list_elem);
     		list_remove(&fte->list_elem);
-    		free(fte);
+    		slab_free(fte_cache, fte);
     	}
     }
 }
@@ -168,7 +184,7 @@ struct frame_table_entry *find_fte(void *addr){ //user
 }
 
 void swap_prevent_on(void *addr){
-	struct sup_page_table_entry *spte = find_spte(addr);
+	struct sup_page_table_entry *spte = get_spte(addr);
 	if(spte == NULL)
 		return;
 	struct frame_table_entry *fte;
@@ -199,14 +215,91 @@ void swap_prevent_off(void *addr){
 	}
 	fte = find_fte(addr);
 	ASSERT(fte);
-	fte->swap_prevention = false;
+	/* Leave frames pinned by frame_pin_user() pinned. */
+	fte->swap_prevention = fte->pin_cnt > 0;
 
 }
 
 void swap_prevention_buffer(const void *buf, size_t size, bool onoff){
 	void *page;
-	lock_acquire(&frame_table_lock);
+	mutex_acquire(&frame_table_lock);
 	for(page = pg_round_down(buf); page < buf + size; page += PGSIZE)
 		onoff ? swap_prevent_on(page) : swap_prevent_off(page);
-	lock_release(&frame_table_lock);
+	mutex_release(&frame_table_lock);
+}
+
+/*
+ * Pin the PAGE_CNT user pages whose page-aligned addresses are in
+ * UPAGES so that the kernel can copy to or from them through their
+ * frames.  Pages that are not resident are brought in, and a page
+ * just below the stack pointer grows the stack.  The frame table
+ * entry of each page is stored in FTES.  The whole batch is pinned
+ * under a single acquisition of frame_table_lock.  A page may
+ * appear more than once, and a page may be pinned again before an
+ * earlier pin is released; it stays pinned until every pin is.
+ * Returns false, with nothing left pinned, if some page is not
+ * part of the address space or if WRITE is true and some page is
+ * read-only.
+ */
+bool frame_pin_user(void *const *upages, size_t page_cnt, bool write,
+					struct frame_table_entry **ftes){
+	void *esp = thread_current()->esp;
+	size_t i;
+
+	mutex_acquire(&frame_table_lock);
+	for(i = 0; i < page_cnt; i++){
+		uint8_t *page = upages[i];
+		struct sup_page_table_entry *spte;
+
+		ASSERT(pg_ofs(page) == 0);
+		if(!is_user_vaddr(page))
+			break;
+		spte = get_spte(page);
+		if(spte == NULL && vma_find(page) != NULL){
+			/* Out of memory for the page's table entry. */
+			mutex_release(&frame_table_lock);
+			frame_unpin_user(ftes, i, false);
+			exit(-1);
+		}
+		if(spte == NULL){
+			/* Same rule as the page fault handler's stack growth. */
+			if(page < (uint8_t *)PHYS_BASE - STACK_SIZE ||
+			   page + PGSIZE <= (uint8_t *)esp - 32)
+				break;
+			allocate_frame(page);
+		}
+		else if(write && !spte->writable)
+			break;
+		else
+			swap_prevent_on(page);
+		ftes[i] = find_fte(page);
+		ASSERT(ftes[i] != NULL && ftes[i]->swap_prevention);
+		ftes[i]->pin_cnt++;
+	}
+	mutex_release(&frame_table_lock);
+
+	if(i < page_cnt){
+		frame_unpin_user(ftes, i, false);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Unpin the PAGE_CNT frames in FTES pinned by frame_pin_user(),
+ * in one pass.  If DIRTY is true, the kernel wrote to the frames,
+ * so mark the user pages dirty as a user write would have.
+ */
+void frame_unpin_user(struct frame_table_entry **ftes, size_t page_cnt, bool dirty){
+	size_t i;
+
+	mutex_acquire(&frame_table_lock);
+	for(i = 0; i < page_cnt; i++){
+		if(dirty)
+			pagedir_set_dirty(ftes[i]->owner->pagedir, ftes[i]->user, true);
+		ASSERT(ftes[i]->pin_cnt > 0);
+		if(--ftes[i]->pin_cnt == 0)
+			ftes[i]->swap_prevention = false;
+	}
+	mutex_release(&frame_table_lock);
 }
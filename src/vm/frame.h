@@ -5,11 +5,12 @@
 #include <list.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "threads/synch.h"
 
 extern struct hash frame_table;
 extern struct list frame_list;
-extern struct lock frame_table_lock;
+extern struct mutex frame_table_lock;
 extern struct list_elem *eviction_ptr;
 struct frame_table_entry
 {
@@ -21,6 +22,7 @@ struct frame_table_entry
 	struct sup_page_table_entry *spte;
 
 	bool swap_prevention;
+	unsigned pin_cnt;		/* Outstanding frame_pin_user() pins. */
 };
 
 void frame_init (void);
@@ -30,5 +32,8 @@ void deallocate_fte(struct frame_table_entry *fte);
 struct frame_table_entry* find_fte(void *addr); //user
 void deallocate_frame_owned_by_thread(void);
 void swap_prevention_buffer(const void *buf, size_t size, bool onoff);
+bool frame_pin_user(void *const *upages, size_t page_cnt, bool write,
+					struct frame_table_entry **ftes);
+void frame_unpin_user(struct frame_table_entry **ftes, size_t page_cnt, bool dirty);
 
 #endif /* vm/frame.h */
@@ -1,49 +1,107 @@
 #include "vm/page.h"
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+#include "vm/vma.h"
 
-/*
- * Initialize supplementary page table
- */
+/* Returns the entry for user page ADDR in the current process's
+ * supplemental page table.  If CREATE is true, allocates the
+ * table and leaf that hold it as needed; otherwise returns NULL
+ * if they do not exist.  Also returns ADDR's table in *TABLEP
+ * and leaf index in *LEAFP, if they are nonnull. */
+static struct sup_page_table_entry *
+spt_slot(void *addr, bool create, struct spt_table **tablep, size_t *leafp){
+	struct sup_page_table *spt = thread_current()->sup_page_dir;
+	struct spt_table *table;
+	size_t leaf = pt_no(addr) / SPT_LEAF_CNT;
 
-unsigned page_hash_function(const struct hash_elem *e, void *aux){
-	uint32_t* user_vaddr = hash_entry(e, struct sup_page_table_entry, hash_elem)->user_vaddr;
-	return hash_int((int)user_vaddr);
+	if(spt == NULL || addr >= PHYS_BASE)
+		return NULL;
+	table = spt->tables[pd_no(addr)];
+	if(table == NULL){
+		if(!create)
+			return NULL;
+		table = calloc(1, sizeof *table);
+		if(table == NULL)
+			return NULL;
+		spt->tables[pd_no(addr)] = table;
+	}
+	if(table->leaves[leaf] == NULL){
+		if(!create)
+			return NULL;
+		table->leaves[leaf] = palloc_get_page(PAL_ZERO);
+		if(table->leaves[leaf] == NULL)
+			return NULL;
+		table->leaf_cnt++;
+	}
+	if(tablep != NULL)
+		*tablep = table;
+	if(leafp != NULL)
+		*leafp = leaf;
+	return &table->leaves[leaf][pt_no(addr) % SPT_LEAF_CNT];
 }
 
-bool page_hash_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED){
-	return hash_entry(a, struct sup_page_table_entry, hash_elem)->user_vaddr < 
-		   hash_entry(b, struct sup_page_table_entry, hash_elem)->user_vaddr;
+/*
+ * Initialize the supplementary page table code
+ */
+void
+page_table_init (void)
+{
+	ASSERT(sizeof(struct sup_page_table_entry) * SPT_LEAF_CNT <= PGSIZE);
+	ASSERT(sizeof(struct sup_page_table) <= PGSIZE);
 }
 
-void 
+/*
+ * Initialize supplementary page table.  Returns false if no page
+ * is free for its root.
+ */
+bool
 page_init (void)
 {
-	thread_current()->sup_page_dir = malloc(sizeof(struct hash));
-	hash_init(thread_current()->sup_page_dir, page_hash_function, page_hash_less, NULL);
+	thread_current()->sup_page_dir = palloc_get_page(PAL_ZERO);
+	return thread_current()->sup_page_dir != NULL;
 }
 
 /*
- * Make new supplemental page table entry for addr 
+ * Make new supplemental page table entry for addr.  Returns NULL
+ * if no memory is free for the table or leaf that holds it.
  */
 struct sup_page_table_entry *
 allocate_page (void *addr)
 {
-	struct sup_page_table_entry *spte = malloc(sizeof(struct sup_page_table_entry));
-	ASSERT(spte);
+	struct spt_table *table;
+	size_t leaf;
+	struct sup_page_table_entry *spte = spt_slot(addr, true, &table, &leaf);
+	if(spte == NULL)
+		return NULL;
+	if(spte->state == SPTE_FREE)
+		table->live_cnt[leaf]++;
+	memset(spte, 0, sizeof *spte);
 	spte->user_vaddr = addr;
-	hash_insert(thread_current()->sup_page_dir, &spte->hash_elem);
 	spte->state = SPTE_MAPPED;
 	spte->dirty = false;
 	return spte;
 }
 
 void deallocate_page(void *addr){
-	struct sup_page_table_entry spte;
-	spte.user_vaddr = addr;
-	struct hash_elem *e;
+	struct spt_table *table;
+	size_t leaf;
+	struct sup_page_table_entry *spte = spt_slot(addr, false, &table, &leaf);
 
-	e = hash_find(thread_current()->sup_page_dir, &spte.hash_elem);
-	hash_delete(thread_current()->sup_page_dir, e);
-	free(hash_entry(e, struct sup_page_table_entry, hash_elem));
+	if(spte == NULL || spte->state == SPTE_FREE)
+		return;
+	spte->state = SPTE_FREE;
+	if(--table->live_cnt[leaf] > 0)
+		return;
+
+	/* Give back the empty leaf, and its table if that is empty too. */
+	palloc_free_page(table->leaves[leaf]);
+	table->leaves[leaf] = NULL;
+	if(--table->leaf_cnt == 0){
+		thread_current()->sup_page_dir->tables[pd_no(addr)] = NULL;
+		free(table);
+	}
 }
       //file, kpage, upage, page_read_bytes, page_zero_bytes, writable
 
@@ -60,38 +118,108 @@ bool lazy_load(struct file *file, off_t ofs, void *upage, size_t page_read_bytes
 }
 
 struct sup_page_table_entry *find_spte(void *addr){ //user page address
-	struct sup_page_table_entry spte;
+	struct sup_page_table_entry *spte = spt_slot(addr, false, NULL, NULL);
+	if(spte == NULL || spte->state == SPTE_FREE)
+		return NULL;
+	return spte;
+}
 
-	struct hash_elem *e;
-	spte.user_vaddr = addr;
-	e = hash_find(thread_current()->sup_page_dir, &spte.hash_elem);
-	if(e==NULL)
+/*
+ * Returns the entry for user page ADDR like find_spte(), but if
+ * the page has not been touched yet and lies in an area of the
+ * address space, first makes its entry from the area, ready to be
+ * loaded from the area's file.  Returns NULL if that entry cannot
+ * be allocated.
+ */
+struct sup_page_table_entry *get_spte(void *addr){
+	struct sup_page_table_entry *spte = find_spte(addr);
+	struct vma *vma;
+	size_t read_bytes;
+
+	if(spte != NULL)
+		return spte;
+	vma = vma_find(addr);
+	if(vma == NULL || vma->file == NULL)
 		return NULL;
-	return hash_entry(e, struct sup_page_table_entry, hash_elem);
+
+	read_bytes = (uint8_t *) addr - vma->start;
+	read_bytes = vma->read_bytes > read_bytes ? vma->read_bytes - read_bytes : 0;
+	if(read_bytes > PGSIZE)
+		read_bytes = PGSIZE;
+	spte = allocate_page(addr);
+	if(spte == NULL)
+		return NULL;
+	lazy_load(vma->file, vma->ofs + ((uint8_t *) addr - vma->start), addr,
+			  read_bytes, PGSIZE - read_bytes, vma->writable, spte);
+	return spte;
+}
+
+/*
+ * Returns the entry for the lowest user page in [START, END) that
+ * has one, or NULL.  Missing tables and leaves are skipped whole,
+ * so walking a range costs one step per 4 MB of unused space.
+ */
+struct sup_page_table_entry *
+find_spte_range(void *start, void *end){
+	struct sup_page_table *spt = thread_current()->sup_page_dir;
+	uintptr_t addr = (uintptr_t) pg_round_down(start);
+
+	if(spt == NULL)
+		return NULL;
+	while(addr < (uintptr_t) end && addr < (uintptr_t) PHYS_BASE){
+		struct spt_table *table = spt->tables[pd_no((void *) addr)];
+		struct sup_page_table_entry *leaf;
+		size_t i;
+
+		if(table == NULL){
+			addr = (addr & ~((uintptr_t) PTSPAN - 1)) + PTSPAN;
+			continue;
+		}
+		leaf = table->leaves[pt_no((void *) addr) / SPT_LEAF_CNT];
+		if(leaf == NULL){
+			addr = (addr & ~((uintptr_t) SPT_LEAF_CNT * PGSIZE - 1)) + SPT_LEAF_CNT * PGSIZE;
+			continue;
+		}
+		for(i = pt_no((void *) addr) % SPT_LEAF_CNT;
+		    i < SPT_LEAF_CNT && addr < (uintptr_t) end; i++, addr += PGSIZE){
+			if(leaf[i].state != SPTE_FREE)
+				return &leaf[i];
+		}
+	}
+	return NULL;
+}
+
+/* Frees SPTE's swap slot, if any. */
+static void
+spte_destroy(struct sup_page_table_entry *spte){
+	if(spte->state == SPTE_EVICTED){
+		swap_free(spte->swap_offset);
+	}
 }
 
+/*
+ * Destroys the current process's supplemental page table,
+ * walking each leaf in address order.
+ */
 void destroy_sup_page_table(){
-	struct hash *spt = thread_current()->sup_page_dir;
-	size_t i;
-
-    for (i = 0; i < spt->bucket_cnt; i++) 
-    {
-        struct list *bucket = &spt->buckets[i];
-        struct list_elem *elem, *next;
-
-        for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
-        {
-            next = list_next (elem);
-            struct sup_page_table_entry *spte;
-            spte = hash_entry(list_entry(elem, struct hash_elem, list_elem), 
-                              struct sup_page_table_entry, hash_elem);
-            if(spte->state == SPTE_EVICTED){
-            	swap_free(spte->swap_offset);
-            }
-
-            free(spte);
-
-        }
-    }
-    hash_destroy(spt, NULL);
-}
\ No newline at end of file
+	struct sup_page_table *spt = thread_current()->sup_page_dir;
+	size_t pd, leaf, i;
+
+	if(spt == NULL)
+		return;
+	for(pd = 0; pd < pd_no(PHYS_BASE); pd++){
+		struct spt_table *table = spt->tables[pd];
+		if(table == NULL)
+			continue;
+		for(leaf = 0; leaf < SPT_LEAVES; leaf++){
+			if(table->leaves[leaf] == NULL)
+				continue;
+			for(i = 0; i < SPT_LEAF_CNT; i++)
+				spte_destroy(&table->leaves[leaf][i]);
+			palloc_free_page(table->leaves[leaf]);
+		}
+		free(table);
+	}
+	palloc_free_page(spt);
+	thread_current()->sup_page_dir = NULL;
+}
@@ -6,41 +6,68 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "devices/timer.h"
-#include <hash.h>
 #include "vm/frame.h"
 
 enum SPTE_STATE{
+	SPTE_FREE,	/* Slot holds no page.  Must be 0. */
 	SPTE_EVICTED,
 	SPTE_MAPPED,
 	SPTE_LOAD,
 };
 
+/* Packed into 32 bytes so that SPT_LEAF_CNT of them fill a page. */
 struct sup_page_table_entry 
 {
 	//uint32_t* kernel_vaddr;
-	bool dirty; // 1: dirty, 0: clean
 	uint32_t* user_vaddr;
-	struct hash_elem hash_elem;
 	enum SPTE_STATE state;
 	//for lazy load
 	struct file *file;
 	off_t ofs;
 	void *kpage;
-	size_t page_read_bytes;
-	size_t page_zero_bytes;
+	uint16_t page_read_bytes;
+	uint16_t page_zero_bytes;
 	bool writable;
+	bool dirty; // 1: dirty, 0: clean
 
 	//for swap
 	int swap_offset;
 
 };
 
-void page_init (void);
+/* Supplemental page table.
+
+   A radix tree laid out like the x86 page directory.  The root
+   has one slot per page directory entry.  Each slot covers 4 MB
+   and points to SPT_LEAVES leaves.  A leaf is one page holding
+   the entries for SPT_LEAF_CNT consecutive user pages in place.
+   Tables and leaves are allocated on first use and freed when
+   they become empty, and entries never move, so pointers to
+   them stay valid until deallocate_page(). */
+#define SPT_LEAF_CNT 128
+#define SPT_LEAVES ((1 << PTBITS) / SPT_LEAF_CNT)
+
+struct spt_table
+{
+	struct sup_page_table_entry *leaves[SPT_LEAVES];
+	uint16_t live_cnt[SPT_LEAVES];	/* Entries in use in each leaf. */
+	int leaf_cnt;			/* Non-null LEAVES. */
+};
+
+struct sup_page_table
+{
+	struct spt_table *tables[1 << PDBITS];
+};
+
+void page_table_init (void);
+bool page_init (void);
 struct sup_page_table_entry *allocate_page (void *addr);
 void deallocate_page(void *addr);
 bool lazy_load(struct file *file, off_t ofs, void *upage, size_t page_read_bytes, 
 			   size_t page_zero_bytes, bool writable, struct sup_page_table_entry *spte);
 struct sup_page_table_entry* find_spte(void *addr); //user page address
+struct sup_page_table_entry *find_spte_range(void *start, void *end);
+struct sup_page_table_entry *get_spte(void *addr);
 void destroy_sup_page_table(void);
 #endif /* vm/page.h */
 
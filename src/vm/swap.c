@@ -1,6 +1,7 @@
 #include "vm/swap.h"
 #include "devices/disk.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include <bitmap.h>
 #include "threads/vaddr.h"
 #include "vm/frame.h"
@@ -15,6 +16,7 @@ static struct bitmap *swap_table;
 
 /* Protects swap_table */
 struct lock swap_lock;
+static struct lock_profile swap_lock_profile;
 
 /* 
  * Initialize swap_device, swap_table, and swap_lock.
@@ -26,6 +28,7 @@ swap_init (void)
 	ASSERT(swap_device != NULL);
 	swap_table = bitmap_create(disk_size(swap_device) * DISK_SECTOR_SIZE / PGSIZE);
 	lock_init(&swap_lock);
+	lock_profile(&swap_lock, &swap_lock_profile, "swap");
 }
 
 /*
@@ -56,6 +59,8 @@ swap_in (void *addr, struct sup_page_table_entry *spte)
 	struct frame_table_entry *fte;
 	fte = find_fte(addr);
 
+	trace_event(TRACE_SWAP_IN, (uint32_t) addr, spte->swap_offset);
+	thread_current()->usage.swap_ins++;
 	read_from_disk(fte->kernel, spte->swap_offset);
 	bitmap_set(swap_table,spte->swap_offset,0);
 	swap_prevent_off(addr);
@@ -110,6 +115,8 @@ swap_out (void)
 	fte->spte->swap_offset = index;
 	fte->spte->dirty = fte->spte->dirty || pagedir_is_dirty(t->pagedir, fte->user) /* || pagedir_is_dirty(t->pagedir, fte->kernel)*/;
 	struct sup_page_table_entry *spte = fte->spte;
+	trace_event(TRACE_SWAP_OUT, (uint32_t) fte->user, index);
+	t->usage.swap_outs++;
 	write_to_disk(fte->kernel, index);
 	eviction_ptr_push(&(fte->list_elem));
 	deallocate_fte(fte);
@@ -0,0 +1,114 @@
+#include "vm/vma.h"
+#include <round.h>
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+static struct slab_cache *vma_cache;
+
+/*
+ * Initialize the object cache shared by all processes' areas
+ */
+void
+vma_init (void)
+{
+	vma_cache = slab_cache_create("vma", sizeof(struct vma), NULL);
+	if(vma_cache == NULL)
+		PANIC("vma_init: can't create vma cache");
+}
+
+/*
+ * Describe LENGTH bytes of the current process's address space,
+ * starting at page-aligned START, as read from FILE at OFS for
+ * READ_BYTES bytes and zeroed after.  LENGTH is rounded up to
+ * whole pages.  Returns the new area, or NULL if it would overlap
+ * another area or leave user space, or if memory is short.
+ */
+struct vma *
+vma_add(void *start, size_t length, struct file *file,
+		off_t ofs, size_t read_bytes, bool writable){
+	struct list *vmas = &thread_current()->vma_list;
+	uint8_t *end = (uint8_t *) start + ROUND_UP(length, PGSIZE);
+	struct list_elem *e;
+	struct vma *vma;
+
+	ASSERT(pg_ofs(start) == 0);
+	if(length == 0 || end <= (uint8_t *) start || end > (uint8_t *) PHYS_BASE)
+		return NULL;
+
+	/* Find the first area past START; the new one goes before it. */
+	for(e = list_begin(vmas); e != list_end(vmas); e = list_next(e)){
+		struct vma *next = list_entry(e, struct vma, elem);
+		if(next->end > (uint8_t *) start){
+			if(next->start < end)
+				return NULL;
+			break;
+		}
+	}
+
+	vma = slab_alloc(vma_cache);
+	if(vma == NULL)
+		return NULL;
+	vma->start = start;
+	vma->end = end;
+	vma->file = file;
+	vma->ofs = ofs;
+	vma->read_bytes = read_bytes;
+	vma->writable = writable;
+	list_insert(e, &vma->elem);
+	return vma;
+}
+
+/*
+ * Return the current process's area that contains ADDR, or NULL.
+ */
+struct vma *
+vma_find(const void *addr){
+	struct list *vmas = &thread_current()->vma_list;
+	struct list_elem *e;
+
+	for(e = list_begin(vmas); e != list_end(vmas); e = list_next(e)){
+		struct vma *vma = list_entry(e, struct vma, elem);
+		if(vma->end > (uint8_t *) addr)
+			return vma->start <= (uint8_t *) addr ? vma : NULL;
+	}
+	return NULL;
+}
+
+/*
+ * Return true if any of the current process's areas overlaps
+ * [START, END).
+ */
+bool
+vma_overlaps(const void *start, const void *end){
+	struct list *vmas = &thread_current()->vma_list;
+	struct list_elem *e;
+
+	for(e = list_begin(vmas); e != list_end(vmas); e = list_next(e)){
+		struct vma *vma = list_entry(e, struct vma, elem);
+		if(vma->end > (uint8_t *) start)
+			return vma->start < (uint8_t *) end;
+	}
+	return false;
+}
+
+/*
+ * Forget VMA.  Pages already faulted in keep their supplemental
+ * page table entries; the caller deals with those.
+ */
+void
+vma_remove(struct vma *vma){
+	list_remove(&vma->elem);
+	slab_free(vma_cache, vma);
+}
+
+/*
+ * Forget all of the current process's areas.
+ */
+void
+vma_destroy(void){
+	struct list *vmas = &thread_current()->vma_list;
+
+	while(!list_empty(vmas))
+		vma_remove(list_entry(list_front(vmas), struct vma, elem));
+}
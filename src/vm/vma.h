@@ -0,0 +1,40 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+
+#include <list.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+/*
+ * A virtual memory area: a run of whole pages in a process's
+ * address space whose contents come from FILE, starting at offset
+ * OFS, with everything past READ_BYTES zeroed.  Executable
+ * segments and mmap regions are described this way, and a page's
+ * supplemental page table entry is only made the first time the
+ * page is touched (see get_spte()).
+ *
+ * An area with a null FILE reserves pages that the kernel maps
+ * by itself; they are never faulted in.
+ */
+struct vma
+{
+	struct list_elem elem;	/* In the owner's vma_list, by address. */
+	uint8_t *start;		/* First page. */
+	uint8_t *end;		/* First page past the area. */
+	struct file *file;	/* Backing file, or NULL. */
+	off_t ofs;		/* File offset of START. */
+	size_t read_bytes;	/* Bytes read from FILE; the rest are 0. */
+	bool writable;
+};
+
+void vma_init (void);
+struct vma *vma_add(void *start, size_t length, struct file *file,
+					off_t ofs, size_t read_bytes, bool writable);
+struct vma *vma_find(const void *addr);
+bool vma_overlaps(const void *start, const void *end);
+void vma_remove(struct vma *vma);
+void vma_destroy(void);
+
+#endif /* vm/vma.h */